@@ -8,24 +8,56 @@
  *
  * DESCRIPTION:
  *    Minishell can handle all programs supported under execvp(3) and will run them
- *    accordingly. Native support for foreground and background exists, but no pipe-
- *    lining or redirection of I/O is available. A maximum of 70 chars divided amon-
- *    gst five arguments can be supplied. Built-in's include cd and exit, which act
- *    like cd(3tcl) exit(3tcl) in bash. 
+ *    accordingly. Native support for foreground and background exists. Commands can
+ *    be joined into a pipeline with |, whose stages run at the same time, and each
+ *    stage can redirect its input with < file, its output with > file or >> file
+ *    (append) and its errors with 2> file. The shell wires the stages together it-
+ *    self, with pipes and the file actions of posix_spawn(3), and reports the wall-
+ *    clock time of every stage and of the whole pipeline. Commands are started with
+ *    posix_spawn rather than fork(2) and execvp, which works like vfork(2), so a
+ *    shell with a big heap starts them as fast as a small one. Built-in's include
+ *    cd and exit, which act like cd(3tcl) exit(3tcl) in bash, hash, jobs, fg, bg and
+ *    wait. End of input, ctrl-d, exits too.
+ *
+ *    Lines are split into words by tokenize in tokenize.c, in one pass, as in sh:
+ *    operators need no spaces around them, '...' keeps everything within it as it
+ *    is, "..." too except that \ escapes ", \, $, ` and newline, and elsewhere \
+ *    escapes any character. A quoted operator is an ordinary word. There is no
+ *    limit on the length of a line or on the number of words, the buffers grow as
+ *    needed and are reused for the next line.
+ *
+ *    Every pipeline is a job in a process group of its own, kept in a job table. A
+ *    SIGCHLD handler waits for children with wait4(2) as soon as they end or stop,
+ *    and reports a job in the background that does so at once, with the CPU time
+ *    and peak RSS of its processes. In a terminal the job in the foreground gets
+ *    the terminal, so ctrl-c and ctrl-z reach it and not the shell. jobs lists the
+ *    jobs, fg [%n] brings one to the foreground, bg [%n] lets a stopped one go on
+ *    in the background and wait [%n] waits for them to end.
+ *
+ *    Like bash, minishell remembers where in PATH it found each command, and runs
+ *    it from there without searching PATH again. The table is emptied when PATH
+ *    changes, and a command is looked up anew when its remembered path fails. hash
+ *    prints the table with the number of times each command was run, hash -r emp-
+ *    ties it and hash name... looks the names up and adds them.
  *
  * EXAMPLES:
  *    'minishell' - runs a shell. For more details regarding shell usage, see e.g.
  *    <http://www.gnu.org/software/bash/manual/bashref.html>
  *
+ *    'sort < in | uniq' - the unique lines of the file in, sorted.
+ *
+ *    'grep "a | b" in>out' - the lines of in with a | b in them, written to out.
+ *
+ *    Build with 'gcc -o minishell minishell.c tokenize.c'.
+ *
  * ENVIRONMENT:
- *    HOME, PATH (via execvp)
+ *    HOME, PATH
  *
  * SEE ALSO:
- *    bash(1), execvp(3)
+ *    bash(1), posix_spawn(3), pipe(2), wait4(2)
  *
  * EXIT STATUS:
- *    0    if OK,
- *    1    can only be returned by a child unable to run execvp(3).
+ *    0    if OK.
  *
  * AUTHOR:
  *    Written by Hannes A. Leskelä <hleskela@kth.se> and Sam Lööf <saml@kth.se>.
@@ -34,36 +66,141 @@
  *
  */
 
+#define _GNU_SOURCE /* För pipe2(). */
+
 #include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
+#include "tokenize.h"
+
+extern char **environ;
+
+#define PIPE_READ ( 0 )
+#define PIPE_WRITE ( 1 )
+#define HASH_SIZE ( 64 ) /* Antal listor i kommandotabellen. */
+#define DEFAULT_PATH "/bin:/usr/bin" /* Om PATH saknas, som för execvp. */
+#define RUNNING ( 0 ) /* Tillstånden för en process eller ett jobb. */
+#define STOPPED ( 1 )
+#define DONE ( 2 )
+#define NOTICE_SIZE ( 512 ) /* Största utskriften om ett jobb. */
+
+/* Ett kommando i en pipeline, med sina omdirigeringar och tider. */
+struct stage {
+  char **argv; /* Pekar in i parsed_user_input, avslutas med NULL. */
+  char *in; /* Filnamnen efter <, > eller >> och 2>, annars NULL. */
+  char *out;
+  char *err;
+  int append; /* 1 om out angavs med >>. */
+  pid_t pid;
+  struct timeval start; /* Då processen skapades. */
+  struct timeval end; /* Då den väntades in. */
+};
+
+/* Ett kommando i hashtabellen och var i PATH det hittades, som i bash. */
+struct command {
+  char *name;
+  char *path;
+  int hits; /* Antal gånger sökvägen använts. */
+  struct command *next; /* Nästa med samma hashvärde. */
+};
+
+struct command *commands[ HASH_SIZE ]; /* Fylls allteftersom kommandon körs. */
+char *hashed_path = NULL; /* PATH då tabellen fylldes. */
 
-void bgPoll(int*);
+/* En process i ett jobb, ett steg i dess pipeline. */
+struct process {
+  pid_t pid; /* -1 om steget inte kunde startas. */
+  char *name;
+  int state; /* RUNNING, STOPPED eller DONE. */
+  int status; /* Från wait4(). */
+  struct timeval start;
+  struct timeval end;
+};
+
+/* Ett jobb, en pipeline i förgrunden eller bakgrunden. */
+struct job {
+  int id; /* Numret i [n] och %n. */
+  pid_t pgid; /* Processgruppen som alla steg ligger i. */
+  char *command;
+  int background;
+  int num_procs;
+  struct process *procs;
+  struct rusage usage; /* Summan för de processer som väntats in, max för RSS. */
+};
+
+/* Jobbtabellen ändras bara med SIGCHLD blockerad, hanteraren läser
+ * och uppdaterar den när barn avslutas eller stoppas. */
+struct job *jobs = NULL;
+int num_jobs = 0;
+int max_jobs = 0;
+sigset_t sigchld_set; /* Bara SIGCHLD. */
+int terminal = 0; /* 1 om STDIN är en terminal, då får jobben den i tur och ordning. */
+pid_t shell_pgid;
+volatile sig_atomic_t interrupted = 0; /* Ctrl-c under wait. */
+
+struct job *addJob(struct stage*,int,int);
+void bgBuiltin(char**);
 void bogus();
-void fillWithNull(char**,int);
-void forkError(int);
+void childHandler(int);
+void clearCommands();
+float elapsed(struct timeval*,struct timeval*);
+void fgBuiltin(char**);
+char *findCommand(char*,char*);
+struct job *findJob(char*,char*);
+void forgetCommand(char*);
+int formatJob(char*,struct job*);
+void foreground(struct job*,int);
+void hashBuiltin(char**);
+struct command *hashCommand(char*);
+unsigned hashName(char*);
+int jobState(struct job*);
+void jobsBuiltin();
+int openRedirect(char*,int);
+int parsePipeline(char**,int,struct stage*);
+void pipeError(int);
+int putNumber(char*,int,long,int);
+int putText(char*,int,char*);
+void removeJob(struct job*);
+void reportJob(struct job*);
+int runPipeline(struct stage*,int,int);
+int spawnPath(pid_t*,char**,posix_spawn_file_actions_t*,posix_spawnattr_t*);
+pid_t spawnStage(struct stage*,int,int,pid_t,int);
 void timeError(int);
-void waitError(int);
+void waitBuiltin(char**);
 
 int main(int argc , char ** argv)
 {
-  const int INPUT_LIMIT = 72; /* För att fgets räknar med newline och \0. */
-  const int MAX_ARGUMENTS = 5; /* Antal argument i varje anrop, inklusive anropet.*/
-  char user_input[INPUT_LIMIT]; /* Den råa inmatningen till fgets(). */
+  char *user_input = NULL; /* Den råa inmatningen till getline(), växer efter behov. */
+  size_t input_size = 0;
 
   /* Status - variabel som får ta emot returvärden ifrån systemanrop för att sedan checkas av.*/
   int status;
-  pid_t childpid;
-  struct timeval tv;
-  struct timeval tv1;
+  int background; /* 1 om kommandot avslutades med &. */
+  int num_params;
+  int num_stages;
+  int i;
 
-  /* Allokerar minne en gång, pekar om till null inför varje körning. */
-  char **parsed_user_input = malloc((MAX_ARGUMENTS) * sizeof(char *));
+  /* Orden och deras text ligger kvar i tokens mellan körningarna, så
+   * att minne bara allokeras när en rad är längre än någon tidigare. */
+  struct tokens tokens;
+  char **parsed_user_input;
+  memset(&tokens,'\0',sizeof(tokens));
+  /* Varje steg tar minst ett ord, fler steg än ord blir det aldrig. */
+  struct stage *stages = NULL;
+  int max_stages = 0;
+
+  struct job *job;
 
   /* Används för att hantera ctrl-c för att inte stänga ned programmet. */
   struct sigaction sigchild;
@@ -71,40 +208,63 @@ int main(int argc , char ** argv)
   sigchild.sa_handler = bogus;
   sigaction(SIGINT, &sigchild, 0);
 
+  /* Barn väntas in av hanteraren så fort de avslutas eller stoppas. */
+  sigchild.sa_handler = childHandler;
+  sigchild.sa_flags = SA_RESTART;
+  sigaction(SIGCHLD, &sigchild, 0);
+  sigemptyset(&sigchld_set);
+  sigaddset(&sigchld_set,SIGCHLD);
+
+  /* I en terminal får varje jobb i förgrunden terminalen, skalet självt
+   * ska inte stoppas av ctrl-z eller av att ta tillbaka den. */
+  terminal = isatty(STDIN_FILENO);
+  if(terminal){
+    signal(SIGTSTP,SIG_IGN);
+    signal(SIGTTIN,SIG_IGN);
+    signal(SIGTTOU,SIG_IGN);
+    setpgid(0,0);
+    shell_pgid = getpgrp();
+    tcsetpgrp(STDIN_FILENO,shell_pgid);
+  }
+  setvbuf(stdout,NULL,_IOLBF,0); /* Så att hanterarens utskrifter kommer i ordning. */
+
   /* Loopen som upprepar inläsning, dvs. själva programmet. */
   for(;;){
-    *user_input = '\0'; /* Nollställer user input*/
+    /* Tar bort jobb i bakgrunden som är klara och redan rapporterats. */
+    sigprocmask(SIG_BLOCK,&sigchld_set,NULL);
+    for(i=num_jobs-1;i>=0;i--){
+      if(jobs[i].background && DONE == jobState(&jobs[i])){
+        removeJob(&jobs[i]);
+      }
+    }
+    sigprocmask(SIG_UNBLOCK,&sigchld_set,NULL);
+
     printf(">");
-    fgets( user_input, INPUT_LIMIT, stdin );
-    
-    size_t ln = strlen(user_input) - 1;
+    fflush(stdout);
+    if(-1 == getline(&user_input,&input_size,stdin)){
+      if(ferror(stdin) && EINTR == errno){ /* Ctrl-c vid prompten. */
+        clearerr(stdin);
+        continue;
+      }
+      printf("\n"); /* Ctrl-d eller slut på inmatningen, som exit. */
+      break;
+    }
 
-    if (user_input[ln] == '\n'){
-      user_input[ln] = '\0';
+    /* Delar upp raden i ord och operatorer, utan gränser för längd eller antal. */
+    num_params = tokenize(&tokens,user_input);
+    if(-1 == num_params){
+      printf("minishell: syntax error: unterminated quote\n");
+      continue;
     }
 
     /* 
      * För att kontra segmentation fault om man bara trycker enter.
      * Inga kommandon är 0 stora.
      */
-    if(strlen(user_input) < 1){
+    if(num_params < 1){
       continue;
     }
-
-    /* Den behandlade inmatningen via strtok(). */
-    char * result;
-    result = strtok(user_input," ");
-    int num_params = 0;
-    
-    /* Så att inga rester blir kvar i matrisen från tidigare körning. */
-    fillWithNull(parsed_user_input,MAX_ARGUMENTS);
-
-    /* Parsar input och lagrar varje ord i en array av char-pekare.*/
-    while(result != NULL && num_params <MAX_ARGUMENTS-1){/* -1 för att vi redan kallat strtok() ovan.*/
-      parsed_user_input[num_params] = result;
-      num_params++;
-      result = strtok(NULL," ");
-    }
+    parsed_user_input = tokens.words;
     
     /* Check ifall exit skrivits.
      * strcmp får ingen errorcheck ty vi kan
@@ -112,8 +272,31 @@ int main(int argc , char ** argv)
      */
     status = strcmp(parsed_user_input[0],"exit");
     if (0 == status){
-      free(parsed_user_input);
-      exit (0);
+      break;
+    }
+
+    /* Check ifall hash skrivits. */
+    if (0 == strcmp(parsed_user_input[0],"hash")){
+      hashBuiltin(parsed_user_input);
+      continue;
+    }
+
+    /* Check ifall jobs, fg, bg eller wait skrivits. */
+    if (0 == strcmp(parsed_user_input[0],"jobs")){
+      jobsBuiltin();
+      continue;
+    }
+    if (0 == strcmp(parsed_user_input[0],"fg")){
+      fgBuiltin(parsed_user_input);
+      continue;
+    }
+    if (0 == strcmp(parsed_user_input[0],"bg")){
+      bgBuiltin(parsed_user_input);
+      continue;
+    }
+    if (0 == strcmp(parsed_user_input[0],"wait")){
+      waitBuiltin(parsed_user_input);
+      continue;
     }
     
     /* Check ifall cd skrivits. */
@@ -135,73 +318,155 @@ int main(int argc , char ** argv)
       continue;
     }
 
-    
-    /* Pollar bakgrundsprocesser. */
-    bgPoll(&status);
-    
+
     /* Check ifall bakgrundsprocess ska startas (& i slutet).*/
-    status = strcmp(parsed_user_input[num_params-1],"&");
-    if (0 == status){
-      parsed_user_input[num_params-1] = '\0';
+    background = 0;
+    if (OP_BACKGROUND == parsed_user_input[num_params-1]){
+      parsed_user_input[--num_params] = NULL;
+      background = 1;
     }
-    
-    
-    /*Startar tidtagningen.*/
-    int temp = gettimeofday(&tv,0);
-    timeError(temp);
-    
-    childpid = fork();
-    forkError(childpid);
-    if( 0 == childpid){
-      
-      execvp(parsed_user_input[0],parsed_user_input);
-      printf("Could not execute command %s\n",parsed_user_input[0]);
-      exit (1); /* Utan denna så skulle barnet köra en onödig wait() */
+
+    /* Delar upp orden i steg och plockar ut omdirigeringarna. */
+    if(num_params > max_stages){
+      max_stages = num_params;
+      stages = realloc(stages,max_stages * sizeof(struct stage));
     }
-    if(0 == status){
-      printf("\nSpawned background process pid: %i\n",childpid);
+    num_stages = parsePipeline(parsed_user_input,num_params,stages);
+    if(num_stages < 1){
       continue;
     }
-    wait (&status);
-    waitError(status);
-    /*Stoppar tidtagningen.*/
-    temp = gettimeofday(&tv1,0);
-    timeError(temp);
-    /*  Man kan inte enkom jämföra µsek, utan sekunderna måste tas med.
-     *  Det är som att ange tid i bara minuter mellan 0-60, om det har gått
-     *  en viss tid kan man få negativa tidsåtgångar, och man får aldrig ett
-     *  värde större än 59 min.*/
-    float time = ((tv1.tv_sec - tv.tv_sec) * 1000.0)
-      + ((tv1.tv_usec - tv.tv_usec) / 1000.0);
-    printf("\nSpawned foreground process pid: %i\n",childpid);
-    printf("Foreground process %i terminated\n",childpid);
-    printf("Wallclock time: %.2f ms\n",time);
-    
+
+    /* Startar alla steg, tiden tas för varje steg för sig. Jobbet
+     * läggs in i tabellen innan hanteraren kan leta efter det. */
+    sigprocmask(SIG_BLOCK,&sigchld_set,NULL);
+    num_stages = runPipeline(stages,num_stages,terminal && !background);
+    job = addJob(stages,num_stages,background);
+    if(job != NULL && background){
+      printf("[%i] %i\n",job->id,job->pgid);
+      for(i=0;i<num_stages;i++){
+        if(stages[i].pid != -1){
+          printf("Spawned background process pid: %i\n",stages[i].pid);
+        }
+      }
+    }else if(job != NULL){
+      foreground(job,0);
+    }
+    sigprocmask(SIG_UNBLOCK,&sigchld_set,NULL);
   }
   
   /* Väluppfostrade mallocs städar efter sig. */
-  free(parsed_user_input);
+  free(user_input);
+  freeTokens(&tokens);
+  free(stages);
+  clearCommands();
+  sigprocmask(SIG_BLOCK,&sigchld_set,NULL);
+  while(num_jobs > 0){ /* Jobben fortsätter, de glöms bara. */
+    removeJob(&jobs[num_jobs-1]);
+  }
+  free(jobs);
   
   return 0;
 }
 
 
-/* bgPoll
+/* addJob
  *
- * bgPoll returns nothing, but loops through any receiving
- * signals from background processes and waits for them 
- * without blocking the main process.
+ * addJob returns the job it added to the job table for the num_stages
+ * stages just started, or NULL if none of them could be started.
+ * SIGCHLD must be blocked.
  *
- * @param    int * status
+ * @param    struct stage * stages
+ * @param    int num_stages
+ * @param    int background
  */
-void bgPoll(int * status){
-  int value =waitpid(-1, status, WNOHANG);
-  while(value >0){
-    if(WIFEXITED(*status)){
-      printf("Background process %i terminated\n",value);
+struct job *addJob(struct stage * stages,int num_stages,int background)
+{
+  int i, len = 0;
+  char **word;
+  struct job *job;
+
+  for(i=0;i<num_stages && -1 == stages[i].pid;i++)
+    ;
+  if(i == num_stages){
+    return NULL;
+  }
+  if(num_jobs == max_jobs){
+    max_jobs = max_jobs ? 2*max_jobs : 8;
+    jobs = realloc(jobs,max_jobs * sizeof(struct job));
+  }
+  job = &jobs[num_jobs];
+  memset(job,'\0',sizeof(*job));
+  job->id = num_jobs ? jobs[num_jobs-1].id + 1 : 1;
+  job->pgid = stages[i].pid; /* Det första steget som startades leder gruppen. */
+  job->background = background;
+  job->num_procs = num_stages;
+  job->procs = malloc(num_stages * sizeof(struct process));
+
+  /* Kommandot skrivs ihop igen för jobs och rapporterna. */
+  for(i=0;i<num_stages;i++){
+    for(word=stages[i].argv;*word != NULL;word++){
+      len += strlen(*word) + 1;
     }
-    value = waitpid(-1, status, WNOHANG);
+    len += (stages[i].in ? strlen(stages[i].in) + 3 : 0) + (stages[i].out ? strlen(stages[i].out) + 4 : 0)
+      + (stages[i].err ? strlen(stages[i].err) + 4 : 0) + 2;
   }
+  job->command = malloc(len + 1);
+  job->command[0] = '\0';
+  for(i=0;i<num_stages;i++){
+    if(i > 0){
+      strcat(job->command,"| ");
+    }
+    for(word=stages[i].argv;*word != NULL;word++){
+      strcat(strcat(job->command,*word)," ");
+    }
+    if(stages[i].in != NULL){
+      strcat(strcat(strcat(job->command,"< "),stages[i].in)," ");
+    }
+    if(stages[i].out != NULL){
+      strcat(strcat(strcat(job->command,stages[i].append ? ">> " : "> "),stages[i].out)," ");
+    }
+    if(stages[i].err != NULL){
+      strcat(strcat(strcat(job->command,"2> "),stages[i].err)," ");
+    }
+    job->procs[i].pid = stages[i].pid;
+    job->procs[i].name = strdup(stages[i].argv[0]);
+    job->procs[i].state = -1 == stages[i].pid ? DONE : RUNNING;
+    job->procs[i].status = 0;
+    job->procs[i].start = stages[i].start;
+    job->procs[i].end = stages[i].start;
+  }
+  job->command[strlen(job->command) - 1] = '\0';
+  num_jobs++;
+  return job;
+}
+
+
+/* bgBuiltin
+ *
+ * bgBuiltin returns nothing and is the built-in bg, which lets a
+ * stopped job, the latest one or %n, go on in the background.
+ *
+ * @param    char ** argv
+ */
+void bgBuiltin(char ** argv)
+{
+  int i;
+  struct job *job;
+
+  sigprocmask(SIG_BLOCK,&sigchld_set,NULL);
+  if(NULL != (job = findJob("bg",argv[1]))){
+    if(STOPPED == jobState(job)){
+      for(i=0;i<job->num_procs;i++){
+        if(STOPPED == job->procs[i].state){
+          job->procs[i].state = RUNNING;
+        }
+      }
+      kill(-job->pgid,SIGCONT);
+    }
+    job->background = 1;
+    printf("[%i] %s &\n",job->id,job->command);
+  }
+  sigprocmask(SIG_UNBLOCK,&sigchld_set,NULL);
 }
 
 
@@ -211,45 +476,860 @@ void bgPoll(int * status){
  * SIGINT for the main() process.
  */
 void bogus(){
+  interrupted = 1;
   printf("\n");
 }
 
 
+/* childHandler
+ *
+ * childHandler returns nothing and is the handler for SIGCHLD. It
+ * waits for every child that has ended, stopped or gone on, with
+ * wait4 for its resource usage, and updates the job table. A job in
+ * the background that ends or stops is reported at once. Only async-
+ * signal-safe calls are made, the report is formatted by hand.
+ *
+ * @param    int sig
+ */
+void childHandler(int sig)
+{
+  int i, j, state, status, len;
+  int saved_errno = errno;
+  char notice[ NOTICE_SIZE + 1 ]; /* Med en tom rad först. */
+  pid_t pid;
+  struct rusage ru;
+  struct timespec ts;
+  struct job *job;
+  struct process *proc;
+
+  while((pid = wait4(-1,&status,WNOHANG | WUNTRACED | WCONTINUED,&ru)) > 0){
+    proc = NULL;
+    for(i=0;i<num_jobs && NULL == proc;i++){
+      for(j=0;j<jobs[i].num_procs;j++){
+        if(jobs[i].procs[j].pid == pid){
+          job = &jobs[i];
+          proc = &job->procs[j];
+          break;
+        }
+      }
+    }
+    if(NULL == proc){
+      continue;
+    }
+    state = jobState(job);
+    if(WIFSTOPPED(status)){
+      proc->state = STOPPED;
+    }else if(WIFCONTINUED(status)){
+      proc->state = RUNNING;
+    }else{
+      proc->state = DONE;
+      proc->status = status;
+      clock_gettime(CLOCK_REALTIME,&ts);
+      TIMESPEC_TO_TIMEVAL(&proc->end,&ts);
+      timeradd(&job->usage.ru_utime,&ru.ru_utime,&job->usage.ru_utime);
+      timeradd(&job->usage.ru_stime,&ru.ru_stime,&job->usage.ru_stime);
+      if(ru.ru_maxrss > job->usage.ru_maxrss){
+        job->usage.ru_maxrss = ru.ru_maxrss;
+      }
+    }
+    if(job->background && jobState(job) != state && RUNNING != jobState(job)){
+      notice[0] = '\n';
+      len = formatJob(notice + 1,job) + 1;
+      write(STDOUT_FILENO,notice,len);
+    }
+  }
+  errno = saved_errno;
+}
+
+
+
+/* clearCommands
+ *
+ * clearCommands returns nothing, it empties the hash table of
+ * commands, as hash -r does.
+ */
+void clearCommands()
+{
+  int i;
+  struct command *cmd;
+
+  for(i=0;i<HASH_SIZE;i++){
+    while(commands[i] != NULL){
+      cmd = commands[i];
+      commands[i] = cmd->next;
+      free(cmd->name);
+      free(cmd->path);
+      free(cmd);
+    }
+  }
+  free(hashed_path);
+  hashed_path = NULL;
+}
+
+
+/* elapsed
+ *
+ * elapsed returns the time in ms from start to end.
+ *
+ * @param    struct timeval * start
+ * @param    struct timeval * end
+ */
+float elapsed(struct timeval * start,struct timeval * end)
+{
+  /*  Man kan inte enkom jämföra µsek, utan sekunderna måste tas med.
+   *  Det är som att ange tid i bara minuter mellan 0-60, om det har gått
+   *  en viss tid kan man få negativa tidsåtgångar, och man får aldrig ett
+   *  värde större än 59 min.*/
+  return ((end->tv_sec - start->tv_sec) * 1000.0)
+    + ((end->tv_usec - start->tv_usec) / 1000.0);
+}
+
+
+/* fgBuiltin
+ *
+ * fgBuiltin returns nothing and is the built-in fg, which brings a
+ * job, the latest one or %n, to the foreground and waits for it.
+ *
+ * @param    char ** argv
+ */
+void fgBuiltin(char ** argv)
+{
+  struct job *job;
+
+  sigprocmask(SIG_BLOCK,&sigchld_set,NULL);
+  if(NULL != (job = findJob("fg",argv[1]))){
+    printf("%s\n",job->command);
+    foreground(job,STOPPED == jobState(job));
+  }
+  sigprocmask(SIG_UNBLOCK,&sigchld_set,NULL);
+}
+
 
-/* fillWithNull
+/* findCommand
  *
- * fillWithNull returns nothing, but loops through a
- * char matrix and fills it with NULL pointers. This
- * is to ensure that no trailing char pointers are
- * left in the matrix parsed_user_input in the main()
- * function.
+ * findCommand returns the path of the first file called name in the
+ * directories of path that can be executed, allocated with malloc, or
+ * NULL if there is none. An empty directory is the current one.
  *
- * @param    char ** matrix
- * @param    int limit
+ * @param    char * name
+ * @param    char * path
  */
-void fillWithNull(char ** matrix,int limit){
-  int j;
-  for(j=0;j<limit;j+=1){
-    matrix[j]=NULL;
+char *findCommand(char * name,char * path)
+{
+  char *file = malloc(strlen(path) + strlen(name) + 3);
+  char *dir = path, *end;
+  size_t len;
+  struct stat st;
+
+  for(;;){
+    end = strchr(dir,':');
+    len = end != NULL ? (size_t)(end - dir) : strlen(dir);
+    if(0 == len){
+      strcpy(file,".");
+      len = 1;
+    }else{
+      memcpy(file,dir,len);
+    }
+    file[len] = '/';
+    strcpy(file + len + 1,name);
+    if(0 == stat(file,&st) && S_ISREG(st.st_mode) && 0 == access(file,X_OK)){
+      return file;
+    }
+    if(NULL == end){
+      break;
+    }
+    dir = end + 1;
   }
+  free(file);
+  return NULL;
 }
 
 
-/* forkError
+/* findJob
  *
- * forkError returns nothing and is only meant to exit a process in a
- * controlled mannor.
+ * findJob returns the job spec names, %n or n, or the latest job if
+ * spec is NULL, or NULL after printing that there is no such job.
+ *
+ * @param    char * builtin
+ * @param    char * spec
+ */
+struct job *findJob(char * builtin,char * spec)
+{
+  int i, id;
+
+  if(NULL == spec){
+    if(num_jobs > 0){
+      return &jobs[num_jobs-1];
+    }
+    printf("minishell: %s: no current job\n",builtin);
+    return NULL;
+  }
+  id = atoi('%' == spec[0] ? spec + 1 : spec);
+  for(i=0;i<num_jobs;i++){
+    if(jobs[i].id == id){
+      return &jobs[i];
+    }
+  }
+  printf("minishell: %s: %s: no such job\n",builtin,spec);
+  return NULL;
+}
+
+
+/* forgetCommand
+ *
+ * forgetCommand returns nothing, it takes name out of the hash table
+ * of commands, if it is there.
+ *
+ * @param    char * name
+ */
+void forgetCommand(char * name)
+{
+  struct command **prev = &commands[hashName(name)];
+  struct command *cmd;
+
+  for(;*prev != NULL;prev = &(*prev)->next){
+    if(0 == strcmp((*prev)->name,name)){
+      cmd = *prev;
+      *prev = cmd->next;
+      free(cmd->name);
+      free(cmd->path);
+      free(cmd);
+      return;
+    }
+  }
+}
+
+
+/* formatJob
+ *
+ * formatJob returns the length of the line it wrote to notice, at most
+ * NOTICE_SIZE bytes, about the state of job, with the exit status of
+ * its last stage and the CPU time and peak RSS of the processes that
+ * have ended. The signal handler uses it too, so it formats by hand.
+ *
+ * @param    char * notice
+ * @param    struct job * job
+ */
+int formatJob(char * notice,struct job * job)
+{
+  int len = 0, status = job->procs[job->num_procs-1].status;
+  int state = jobState(job);
+
+  len = putText(notice,len,"[");
+  len = putNumber(notice,len,job->id,1);
+  len = putText(notice,len,"] ");
+  if(RUNNING == state){
+    len = putText(notice,len,"Running\t");
+  }else if(STOPPED == state){
+    len = putText(notice,len,"Stopped\t");
+  }else if(WIFSIGNALED(status)){
+    len = putText(notice,len,"Signal ");
+    len = putNumber(notice,len,WTERMSIG(status),1);
+    len = putText(notice,len,"\t");
+  }else if(0 != WEXITSTATUS(status)){
+    len = putText(notice,len,"Exit ");
+    len = putNumber(notice,len,WEXITSTATUS(status),1);
+    len = putText(notice,len,"\t");
+  }else{
+    len = putText(notice,len,"Done\t");
+  }
+  len = putText(notice,len,job->command);
+  len = putText(notice,len,"\tuser ");
+  len = putNumber(notice,len,job->usage.ru_utime.tv_sec,1);
+  len = putText(notice,len,".");
+  len = putNumber(notice,len,job->usage.ru_utime.tv_usec / 1000,3);
+  len = putText(notice,len," s, sys ");
+  len = putNumber(notice,len,job->usage.ru_stime.tv_sec,1);
+  len = putText(notice,len,".");
+  len = putNumber(notice,len,job->usage.ru_stime.tv_usec / 1000,3);
+  len = putText(notice,len," s, max RSS ");
+  len = putNumber(notice,len,job->usage.ru_maxrss,1);
+  len = putText(notice,len," KiB\n");
+  if(NOTICE_SIZE == len){ /* Avkortad, men raden avslutas. */
+    notice[len-1] = '\n';
+  }
+  return len;
+}
+
+
+/* foreground
+ *
+ * foreground returns nothing, it gives job the terminal, lets it go
+ * on first if cont is set, and waits until it has ended or stopped.
+ * An ended job is reported and taken out of the job table, a stopped
+ * one is left there in the background. SIGCHLD must be blocked.
+ *
+ * @param    struct job * job
+ * @param    int cont
+ */
+void foreground(struct job * job,int cont)
+{
+  int i;
+  sigset_t unblocked;
+
+  job->background = 0;
+  if(terminal){
+    tcsetpgrp(STDIN_FILENO,job->pgid);
+  }
+  if(cont){
+    for(i=0;i<job->num_procs;i++){
+      if(STOPPED == job->procs[i].state){
+        job->procs[i].state = RUNNING;
+      }
+    }
+    kill(-job->pgid,SIGCONT);
+  }
+  /* Hanteraren väntar in barnen, här sover skalet bara tills dess. */
+  sigprocmask(SIG_BLOCK,NULL,&unblocked);
+  sigdelset(&unblocked,SIGCHLD);
+  while(RUNNING == jobState(job)){
+    sigsuspend(&unblocked);
+  }
+  if(terminal){
+    tcsetpgrp(STDIN_FILENO,shell_pgid);
+  }
+  if(STOPPED == jobState(job)){
+    job->background = 1;
+    printf("\n[%i] Stopped\t%s\n",job->id,job->command);
+    return;
+  }
+  reportJob(job);
+  removeJob(job);
+}
+
+
+/* hashBuiltin
+ *
+ * hashBuiltin returns nothing and is the built-in hash. Without
+ * arguments it prints the hashed commands with the number of times
+ * each was used, as bash does. hash -r empties the table and hash
+ * name... looks the names up in PATH and adds them.
+ *
+ * @param    char ** argv
+ */
+void hashBuiltin(char ** argv)
+{
+  int i, empty = 1;
+  struct command *cmd;
+
+  if(argv[1] != NULL && 0 == strcmp(argv[1],"-r")){
+    clearCommands();
+    return;
+  }
+  if(argv[1] != NULL){
+    for(i=1;argv[i] != NULL;i++){
+      forgetCommand(argv[i]);
+      if(NULL == hashCommand(argv[i])){
+        printf("minishell: hash: %s: not found\n",argv[i]);
+      }
+    }
+    return;
+  }
+  for(i=0;i<HASH_SIZE;i++){
+    for(cmd = commands[i];cmd != NULL;cmd = cmd->next){
+      if(empty){
+        printf("hits\tcommand\n");
+        empty = 0;
+      }
+      printf("%4i\t%s\n",cmd->hits,cmd->path);
+    }
+  }
+  if(empty){
+    printf("minishell: hash table empty\n");
+  }
+}
+
+
+/* hashCommand
+ *
+ * hashCommand returns the entry of the hash table for the command
+ * name, after looking it up in PATH if it is not there yet, or NULL
+ * if PATH has no such command. The whole table is emptied first if
+ * PATH has changed since it was filled.
+ *
+ * @param    char * name
+ */
+struct command *hashCommand(char * name)
+{
+  char *path = getenv("PATH");
+  char *file;
+  unsigned h = hashName(name);
+  struct command *cmd;
+
+  if(NULL == path){
+    path = DEFAULT_PATH;
+  }
+  if(NULL == hashed_path || 0 != strcmp(hashed_path,path)){
+    clearCommands();
+    hashed_path = strdup(path);
+  }
+  for(cmd = commands[h];cmd != NULL;cmd = cmd->next){
+    if(0 == strcmp(cmd->name,name)){
+      return cmd;
+    }
+  }
+  if(NULL == (file = findCommand(name,path))){
+    return NULL;
+  }
+  cmd = malloc(sizeof(struct command));
+  cmd->name = strdup(name);
+  cmd->path = file;
+  cmd->hits = 0;
+  cmd->next = commands[h];
+  commands[h] = cmd;
+  return cmd;
+}
+
+
+/* hashName
+ *
+ * hashName returns the list of the hash table of commands that name
+ * belongs in.
+ *
+ * @param    char * name
+ */
+unsigned hashName(char * name)
+{
+  unsigned h = 5381;
+
+  while(*name != '\0'){
+    h = h * 33 + (unsigned char) *name++;
+  }
+  return h % HASH_SIZE;
+}
+
+
+/* jobState
+ *
+ * jobState returns RUNNING if any process of job runs, else STOPPED
+ * if any is stopped, else DONE.
+ *
+ * @param    struct job * job
+ */
+int jobState(struct job * job)
+{
+  int i, state = DONE;
+
+  for(i=0;i<job->num_procs;i++){
+    if(RUNNING == job->procs[i].state){
+      return RUNNING;
+    }
+    if(STOPPED == job->procs[i].state){
+      state = STOPPED;
+    }
+  }
+  return state;
+}
+
+
+/* jobsBuiltin
+ *
+ * jobsBuiltin returns nothing and is the built-in jobs, which prints
+ * every job in the job table with its state and resource usage.
+ */
+void jobsBuiltin()
+{
+  int i;
+  char notice[ NOTICE_SIZE ];
+
+  sigprocmask(SIG_BLOCK,&sigchld_set,NULL);
+  for(i=0;i<num_jobs;i++){
+    fwrite(notice,1,formatJob(notice,&jobs[i]),stdout);
+  }
+  sigprocmask(SIG_UNBLOCK,&sigchld_set,NULL);
+}
+
+
+/* openRedirect
+ *
+ * openRedirect returns a descriptor for the file of a redirection, or
+ * -1 after printing why it could not be opened. It is opened close-on-
+ * exec, only the stage it is put in place for keeps it.
+ *
+ * @param    char * file
+ * @param    int flags
+ */
+int openRedirect(char * file,int flags)
+{
+  int fd = open(file,flags | O_CLOEXEC,0666);
+
+  if( -1 == fd ){
+    printf("minishell: %s: %s\n",file,strerror(errno));
+  }
+  return fd;
+}
+
+
+/* parsePipeline
+ *
+ * parsePipeline returns the number of stages the num_params words
+ * hold, split at |, or 0 after printing a syntax error. Each stage
+ * gets its words in argv and the file names after <, >, >> and 2>,
+ * which are taken out of the words. The words are moved down in
+ * place and the end of each stage is marked with NULL.
+ *
+ * @param    char ** words
+ * @param    int num_params
+ * @param    struct stage * stages
+ */
+int parsePipeline(char ** words,int num_params,struct stage * stages)
+{
+  int r, w = 0, n = 0;
+  char *bad = NULL; /* Ordet där syntaxfelet hittades. */
+  struct stage *s = stages;
+
+  memset(s,'\0',sizeof(*s));
+  s->argv = words;
+  for(r=0;r<num_params && bad == NULL;r++){
+    char *word = words[r];
+    char **file = NULL;
+
+    if(OP_PIPE == word){
+      if(s->argv == &words[w]){ /* Tomt steg. */
+        bad = word;
+        continue;
+      }
+      words[w++] = NULL;
+      s = &stages[++n];
+      memset(s,'\0',sizeof(*s));
+      s->argv = &words[w];
+      continue;
+    }
+    if(OP_INPUT == word){
+      file = &s->in;
+    }else if(OP_OUTPUT == word || OP_APPEND == word){
+      file = &s->out;
+      s->append = (OP_APPEND == word);
+    }else if(OP_ERROR == word){
+      file = &s->err;
+    }else if(isOperator(word)){ /* Ett & mitt i raden. */
+      bad = word;
+      continue;
+    }
+    if(file == NULL){
+      words[w++] = word;
+      continue;
+    }
+    if(r+1 == num_params){ /* Filnamnet saknas. */
+      bad = "newline";
+      continue;
+    }
+    if(isOperator(words[r+1])){
+      bad = words[r+1];
+      continue;
+    }
+    *file = words[++r];
+  }
+  if(bad == NULL && s->argv == &words[w]){
+    bad = "newline";
+  }
+  if(bad != NULL){
+    printf("minishell: syntax error near '%s'\n",bad);
+    return 0;
+  }
+  words[w] = NULL;
+  return n + 1;
+}
+
+
+/* pipeError
+ *
+ * pipeError returns nothing but prints the errno message to STDOUT
+ * to keep the user updated.
  *
  * @param    int errorCode
  */
-void forkError(int errorCode)
-{ 
+void pipeError(int errorCode)
+{
   if( -1 == errorCode ){
-    printf("Cannot fork process.\n%s\n",strerror(errno));
+    printf("Cannot create pipe.\n%s\n",strerror(errno));
   }
 }
 
 
+/* putNumber
+ *
+ * putNumber returns the length of notice after n was written at len,
+ * with at least width digits. It is safe in a signal handler.
+ *
+ * @param    char * notice
+ * @param    int len
+ * @param    long n
+ * @param    int width
+ */
+int putNumber(char * notice,int len,long n,int width)
+{
+  char digits[ 24 ];
+  int i = 0;
+
+  if(n < 0){
+    len = putText(notice,len,"-");
+    n = -n;
+  }
+  do{
+    digits[i++] = '0' + n % 10;
+    n /= 10;
+  }while(n > 0 || i < width);
+  while(i > 0 && len < NOTICE_SIZE){
+    notice[len++] = digits[--i];
+  }
+  return len;
+}
+
+
+/* putText
+ *
+ * putText returns the length of notice after text was written at len,
+ * as much of it as fits in NOTICE_SIZE. It is safe in a signal handler.
+ *
+ * @param    char * notice
+ * @param    int len
+ * @param    char * text
+ */
+int putText(char * notice,int len,char * text)
+{
+  while(*text != '\0' && len < NOTICE_SIZE){
+    notice[len++] = *text++;
+  }
+  return len;
+}
+
+
+/* removeJob
+ *
+ * removeJob returns nothing, it takes job out of the job table. The
+ * jobs after it move down, so the table stays in order of id.
+ * SIGCHLD must be blocked.
+ *
+ * @param    struct job * job
+ */
+void removeJob(struct job * job)
+{
+  int i;
+
+  for(i=0;i<job->num_procs;i++){
+    free(job->procs[i].name);
+  }
+  free(job->procs);
+  free(job->command);
+  memmove(job,job + 1,(&jobs[--num_jobs] - job) * sizeof(struct job));
+}
+
+
+/* reportJob
+ *
+ * reportJob returns nothing, it prints the wallclock time of every
+ * stage of a job that ended in the foreground, from its spawn, of the
+ * whole job, and its CPU time and peak RSS.
+ *
+ * @param    struct job * job
+ */
+void reportJob(struct job * job)
+{
+  int i;
+  struct process *procs = job->procs;
+  struct timeval tv = procs[0].start;
+
+  if(1 == job->num_procs){
+    printf("\nSpawned foreground process pid: %i\n",procs[0].pid);
+    printf("Foreground process %i terminated\n",procs[0].pid);
+    tv = procs[0].end;
+  }else{
+    printf("\n");
+    for(i=0;i<job->num_procs;i++){
+      if(-1 == procs[i].pid){
+        printf("Stage %i, %s, was not started\n",i+1,procs[i].name);
+        continue;
+      }
+      printf("Stage %i, %s, pid %i terminated after %.2f ms\n",
+             i+1,procs[i].name,procs[i].pid,elapsed(&procs[i].start,&procs[i].end));
+      if(timercmp(&procs[i].end,&tv,>)){
+        tv = procs[i].end;
+      }
+    }
+  }
+  printf("Wallclock time: %.2f ms\n",elapsed(&procs[0].start,&tv));
+  printf("CPU time: user %.2f ms, sys %.2f ms, max RSS %li KiB\n",
+         job->usage.ru_utime.tv_sec * 1000.0 + job->usage.ru_utime.tv_usec / 1000.0,
+         job->usage.ru_stime.tv_sec * 1000.0 + job->usage.ru_stime.tv_usec / 1000.0,
+         job->usage.ru_maxrss);
+}
+
+
+/* runPipeline
+ *
+ * runPipeline returns the number of stages it went through, all of
+ * them unless a pipe could not be created. Every stage is spawned at
+ * once, with a pipe from each one to the next, so they all run at the
+ * same time, in a process group of their own. A stage that could not
+ * be started has pid -1. With tty set the group gets the terminal as
+ * soon as its first process starts.
+ *
+ * @param    struct stage * stages
+ * @param    int num_stages
+ * @param    int tty
+ */
+int runPipeline(struct stage * stages,int num_stages,int tty)
+{
+  int i, status;
+  int prev = -1; /* Läsänden av pipen från steget innan. */
+  int pfd[ 2 ] = { -1, -1 };
+  pid_t pgid = 0; /* Det första steget som startas får en egen grupp. */
+
+  for(i=0;i<num_stages;i++){
+    /* Close-on-exec, så att bara steget som får en ände behåller den. */
+    if(i < num_stages-1){
+      status = pipe2(pfd,O_CLOEXEC);
+      pipeError(status);
+      if(-1 == status){
+        break;
+      }
+    }
+    status = gettimeofday(&stages[i].start,0);
+    timeError(status);
+    stages[i].pid = spawnStage(&stages[i],prev,i < num_stages-1 ? pfd[ PIPE_WRITE ] : -1,pgid,tty);
+    if(0 == pgid && -1 != stages[i].pid){
+      pgid = stages[i].pid;
+    }
+    /* Föräldern behöver inga pipe-ändar som barnen redan har. */
+    if(prev != -1){
+      close(prev);
+      prev = -1;
+    }
+    if(i < num_stages-1){
+      close(pfd[ PIPE_WRITE ]);
+      prev = pfd[ PIPE_READ ];
+    }
+  }
+  if(prev != -1){
+    close(prev);
+  }
+  return i;
+}
+
+
+/* spawnPath
+ *
+ * spawnPath returns 0 after starting argv with posix_spawn, with the
+ * file actions in actions and the attributes in attr and its pid in
+ * *pid, or the error number.
+ * A command without a / is run from the path the hash table has for
+ * it, so PATH is only searched the first time. If that path fails the
+ * command is forgotten and looked up once more.
+ *
+ * @param    pid_t * pid
+ * @param    char ** argv
+ * @param    posix_spawn_file_actions_t * actions
+ * @param    posix_spawnattr_t * attr
+ */
+int spawnPath(pid_t * pid,char ** argv,posix_spawn_file_actions_t * actions,posix_spawnattr_t * attr)
+{
+  int tries, status = ENOENT;
+  struct command *cmd;
+
+  if(NULL != strchr(argv[0],'/')){ /* Sökvägar hashas inte. */
+    return posix_spawn(pid,argv[0],actions,attr,argv,environ);
+  }
+  for(tries=0;tries<2;tries++){
+    if(NULL == (cmd = hashCommand(argv[0]))){
+      return ENOENT;
+    }
+    status = posix_spawn(pid,cmd->path,actions,attr,argv,environ);
+    if(0 == status){
+      cmd->hits++;
+      return 0;
+    }
+    forgetCommand(argv[0]); /* Filen kan ha flyttats eller tagits bort. */
+  }
+  return status;
+}
+
+
+/* spawnStage
+ *
+ * spawnStage returns the pid of the process running the stage s, or
+ * -1 after printing why it could not be started. posix_spawn starts
+ * it the way vfork does (clone(CLONE_VM|CLONE_VFORK) in glibc), so the
+ * page tables of the shell are not copied, however big it has grown.
+ * The pipe ends in and out, -1 if there are none, and then the files
+ * of the redirections are put in place by file actions in the child,
+ * so a file wins over a pipe. The child joins the process group pgid,
+ * or starts one if it is 0, with no signals blocked and the job
+ * control signals the shell ignores back to their defaults. A new
+ * group started with tty set takes the terminal in the child itself,
+ * before the command runs, so a command that reads it at once is not
+ * stopped by SIGTTIN before foreground has handed it over.
+ *
+ * @param    struct stage * s
+ * @param    int in
+ * @param    int out
+ * @param    pid_t pgid
+ * @param    int tty
+ */
+pid_t spawnStage(struct stage * s,int in,int out,pid_t pgid,int tty)
+{
+  posix_spawn_file_actions_t actions;
+  posix_spawnattr_t attr;
+  sigset_t signals;
+  int fd[ 3 ] = { -1, -1, -1 }; /* Filerna för <, > och 2>. */
+  int i, status = 0;
+  pid_t pid = -1;
+
+  if(s->in != NULL && -1 == (fd[0] = openRedirect(s->in,O_RDONLY))){
+    status = -1;
+  }
+  if(s->out != NULL && 0 == status
+     && -1 == (fd[1] = openRedirect(s->out,O_WRONLY | O_CREAT | (s->append ? O_APPEND : O_TRUNC)))){
+    status = -1;
+  }
+  if(s->err != NULL && 0 == status
+     && -1 == (fd[2] = openRedirect(s->err,O_WRONLY | O_CREAT | O_TRUNC))){
+    status = -1;
+  }
+  if(0 == status){
+    posix_spawn_file_actions_init(&actions);
+    /* Görs efter setpgid, med alla signaler blockerade, och före dup2
+     * så att STDIN ännu är skalets terminal. */
+    if(tty && 0 == pgid){
+      posix_spawn_file_actions_addtcsetpgrp_np(&actions,STDIN_FILENO);
+    }
+    if(in != -1){
+      posix_spawn_file_actions_adddup2(&actions,in,STDIN_FILENO);
+    }
+    if(out != -1){
+      posix_spawn_file_actions_adddup2(&actions,out,STDOUT_FILENO);
+    }
+    for(i=0;i<3;i++){
+      if(fd[i] != -1){
+        posix_spawn_file_actions_adddup2(&actions,fd[i],i);
+      }
+    }
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setpgroup(&attr,pgid);
+    sigemptyset(&signals);
+    posix_spawnattr_setsigmask(&attr,&signals);
+    sigaddset(&signals,SIGTSTP);
+    sigaddset(&signals,SIGTTIN);
+    sigaddset(&signals,SIGTTOU);
+    posix_spawnattr_setsigdefault(&attr,&signals);
+    posix_spawnattr_setflags(&attr,POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+    status = spawnPath(&pid,s->argv,&actions,&attr);
+    if(status != 0){
+      printf("Could not execute command %s\n%s\n",s->argv[0],strerror(status));
+      pid = -1;
+    }
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+  }
+  for(i=0;i<3;i++){
+    if(fd[i] != -1){
+      close(fd[i]);
+    }
+  }
+  return pid;
+}
+
+
 /* timeError
  *
  * timeError returns nothing but prints the errno message to STDOUT
@@ -264,16 +1344,37 @@ void timeError(int errorCode)
   }
 }
 
-/* waitError
+
+/* waitBuiltin
  *
- * waitError returns nothing but prints the errno message to STDOUT
- * to keep the user updated.
+ * waitBuiltin returns nothing and is the built-in wait, which waits
+ * for every job running in the background, or for job %n, to end or
+ * stop. Each is reported as it does, ctrl-c stops the waiting.
  *
- * @param    int errorCode
+ * @param    char ** argv
  */
-void waitError(int errorCode)
+void waitBuiltin(char ** argv)
 {
-  if( -1 == errorCode ){
-    printf("Error signal recieved from child process.\n%s\n",strerror(errno));
+  int i, waiting = 1;
+  sigset_t unblocked;
+  struct job *job = NULL;
+
+  sigprocmask(SIG_BLOCK,&sigchld_set,&unblocked);
+  sigdelset(&unblocked,SIGCHLD);
+  if(argv[1] != NULL && NULL == (job = findJob("wait",argv[1]))){
+    waiting = 0;
+  }
+  interrupted = 0;
+  while(waiting && !interrupted){
+    waiting = 0;
+    for(i=0;i<num_jobs;i++){
+      if((NULL == job || job->id == jobs[i].id) && jobs[i].background && RUNNING == jobState(&jobs[i])){
+        waiting = 1;
+      }
+    }
+    if(waiting){
+      sigsuspend(&unblocked);
+    }
   }
+  sigprocmask(SIG_UNBLOCK,&sigchld_set,NULL);
 }
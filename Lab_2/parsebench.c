@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "tokenize.h"
+
+/* Build with 'gcc -O2 -o parsebench parsebench.c tokenize.c'. Measures
+ * how long splitting a command line into words takes, with tokenize and,
+ * as a baseline, with strtok on blanks the way minishell used to, which
+ * knows nothing of quotes or operators. Lines of about each of the sizes
+ * given in bytes (by default 1024 4096 16384 65536) are made up of words,
+ * quoted words, escapes and operators, and each is split ROUNDS times:
+ *
+ *    parser line_bytes words count mean_ns p50_ns p99_ns mb_per_s
+ *
+ * tab separated. words is what the parser made of the line, mb_per_s is
+ * the bytes of line split per second at the mean.
+ */
+
+#ifndef ROUNDS
+#define ROUNDS 2000                                     /* splits per parser and size */
+#endif
+
+static const char *pieces[] = {
+  "ls", "-l", "/usr/local/bin", "|", "grep", "\"a b c\"", "'$HOME | x'",
+  "file\\ name", ">", "out.txt", "2>err", "<in", "sort", "-k2,2n", ">>", "log",
+};
+
+static long long now(void){
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec*1000000000LL + ts.tv_nsec;
+}
+
+static int cmp(const void *a, const void *b){
+  long long x = *(const long long *)a, y = *(const long long *)b;
+
+  return x < y ? -1 : x > y;
+}
+
+/* A line of at least size bytes, ending with a newline like getline's. */
+static char *makeLine(size_t size){
+  size_t n = sizeof(pieces)/sizeof(pieces[0]), len = 0, i;
+  char *line = malloc(size + 64);
+
+  for(i = 0; len < size; i++)
+    len += sprintf(line + len, "%s%s", i ? " " : "", pieces[i*7 % n]);
+  strcpy(line + len, "\n");
+  return line;
+}
+
+/* strtok writes into the line, so it gets a fresh copy each round. */
+static int splitBlanks(char *copy, const char *line, char ***words, int *max){
+  int n = 0;
+  char *w;
+
+  strcpy(copy, line);
+  for(w = strtok(copy, " \t\n"); w != NULL; w = strtok(NULL, " \t\n")){
+    if(n + 1 >= *max){
+      *max = *max ? 2 * *max : 16;
+      *words = realloc(*words, *max * sizeof(char *));
+    }
+    (*words)[n++] = w;
+  }
+  (*words)[n] = NULL;
+  return n;
+}
+
+static void measure(const char *parser, const char *line){
+  static long long t[ROUNDS];
+  static struct tokens tokens;
+  static char **words = NULL;
+  static int max = 0;
+  size_t len = strlen(line);
+  char *copy = malloc(len + 1);
+  long long start, total = 0;
+  int i, n = 0;
+
+  for(i = 0; i < ROUNDS; i++){
+    start = now();
+    if(strcmp(parser, "tokenize") == 0)
+      n = tokenize(&tokens, (char *) line);
+    else
+      n = splitBlanks(copy, line, &words, &max);
+    t[i] = now() - start;
+    total += t[i];
+  }
+  qsort(t, ROUNDS, sizeof(long long), cmp);
+  printf("%s\t%zu\t%d\t%d\t%.0f\t%lld\t%lld\t%.1f\n", parser, len, n, ROUNDS,
+         (double) total/ROUNDS, t[(ROUNDS-1)/2], t[(ROUNDS-1)*99/100],
+         total ? len*1e3*ROUNDS/total : 0.0);
+  free(copy);
+}
+
+int main(int argc, char *argv[]){
+  static const char *defaults[] = { "1024", "4096", "16384", "65536" };
+  const char **sizes = (const char **) argv + 1;
+  int nsizes = argc - 1, i;
+  char *line;
+
+  if(nsizes == 0){
+    sizes = defaults;
+    nsizes = sizeof(defaults)/sizeof(defaults[0]);
+  }
+  setvbuf(stdout, NULL, _IOLBF, 0);
+  for(i = 0; i < nsizes; i++){
+    line = makeLine(strtoul(sizes[i], NULL, 10));
+    measure("strtok", line);
+    measure("tokenize", line);
+    free(line);
+  }
+  return 0;
+}
@@ -0,0 +1,111 @@
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+/* Build with 'gcc -O2 -o spawnbench spawnbench.c'. Measures how long
+ * starting a command takes with fork and execv, vfork and execv, and
+ * posix_spawn, as the parent grows. The heap is grown to each of the
+ * sizes given in MiB (by default 0 64 256 1024), touching every page,
+ * and SPAWNS commands are started with each method, one at a time:
+ *
+ *    method rss_mib count spawn_mean spawn_p50 spawn_p99 total_mean
+ *
+ * with the times in µs, tab separated. spawn is until the call returns
+ * in the parent, total until the command (/bin/true) has been waited
+ * for. rss_mib is the peak resident size of the parent.
+ */
+
+#ifndef SPAWNS
+#define SPAWNS 200                                      /* commands per method and size */
+#endif
+#define CHUNK (16*1024*1024)                            /* the heap grows this much at a time */
+#define COMMAND "/bin/true"
+
+extern char **environ;
+
+static char *argv0[] = { "true", NULL };
+
+static long long now(void){
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec*1000000000LL + ts.tv_nsec;
+}
+
+static int cmp(const void *a, const void *b){
+  long long x = *(const long long *)a, y = *(const long long *)b;
+
+  return x < y ? -1 : x > y;
+}
+
+/* Starts COMMAND with method, returns its pid or -1. */
+static pid_t start(const char *method){
+  pid_t pid;
+
+  if(strcmp(method, "posix_spawn") == 0)
+    return posix_spawn(&pid, COMMAND, NULL, NULL, argv0, environ) == 0 ? pid : -1;
+  pid = strcmp(method, "vfork") == 0 ? vfork() : fork();
+  if(pid == 0){
+    execv(COMMAND, argv0);
+    _exit(127);
+  }
+  return pid;
+}
+
+static void measure(const char *method){
+  static long long spawn[SPAWNS];
+  long long t, spawnTotal = 0, total = 0;
+  struct rusage ru;
+  pid_t pid;
+  int i, status;
+
+  for(i = 0; i < SPAWNS; i++){
+    t = now();
+    if((pid = start(method)) == -1){
+      perror(method);
+      exit(1);
+    }
+    spawn[i] = now() - t;
+    waitpid(pid, &status, 0);
+    total += now() - t;
+    spawnTotal += spawn[i];
+  }
+  qsort(spawn, SPAWNS, sizeof(long long), cmp);
+  getrusage(RUSAGE_SELF, &ru);
+  printf("%s\t%ld\t%d\t%.1f\t%.1f\t%.1f\t%.1f\n", method, ru.ru_maxrss/1024, SPAWNS,
+         spawnTotal/1e3/SPAWNS, spawn[(SPAWNS-1)/2]/1e3, spawn[(SPAWNS-1)*99/100]/1e3,
+         total/1e3/SPAWNS);
+}
+
+int main(int argc, char *argv[]){
+  static const char *defaults[] = { "0", "64", "256", "1024" };
+  const char **sizes = (const char **) argv + 1;
+  int nsizes = argc - 1, i;
+  size_t grown = 0, want;
+  char *p;
+
+  if(nsizes == 0){
+    sizes = defaults;
+    nsizes = sizeof(defaults)/sizeof(defaults[0]);
+  }
+  setvbuf(stdout, NULL, _IOLBF, 0);
+  for(i = 0; i < nsizes; i++){
+    want = strtoul(sizes[i], NULL, 10)*1024*1024;
+    for(; grown + CHUNK <= want; grown += CHUNK){     /* kept until exit, like a shell's heap */
+      if((p = malloc(CHUNK)) == NULL){
+        perror("malloc");
+        return 1;
+      }
+      memset(p, 1, CHUNK);
+    }
+    measure("fork");
+    measure("vfork");
+    measure("posix_spawn");
+  }
+  return 0;
+}
@@ -0,0 +1,210 @@
+/*
+ *
+ * NAME:
+ *    tokenize.c - splits a minishell command line into words and operators.
+ *
+ * DESCRIPTION:
+ *    The line is read once, from left to right. Words are separated by blanks and
+ *    by the operators |, <, >, >>, 2> and &, which need no blanks around them. 2>
+ *    is only an operator at the start of a word. Within '...' every character is
+ *    taken as it is, within "..." a backslash only escapes ", \, $, ` and newline,
+ *    and elsewhere it escapes any character. A quoted operator is a word.
+ *
+ *    The text of the words is copied into an arena, where each ends with \0. The
+ *    arena and the array of words only ever grow, so once they have room for the
+ *    longest line no more memory is allocated, however many lines are read.
+ *
+ * AUTHOR:
+ *    Written by Hannes A. Leskelä <hleskela@kth.se> and Sam Lööf <saml@kth.se>.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "tokenize.h"
+
+/* De längre före de kortare som de börjar med. */
+char *operators[] = { ">>", "2>", "|", "<", ">", "&", NULL };
+
+/* 1 för tecken som kan avsluta ett ord eller behöver behandlas, 0 för vanliga. */
+static char special[256] = {
+  ['\0'] = 1, [' '] = 1, ['\t'] = 1, ['\n'] = 1, ['\\'] = 1, ['\''] = 1, ['"'] = 1,
+  ['|'] = 1, ['<'] = 1, ['>'] = 1, ['&'] = 1, ['2'] = 1,
+};
+
+void addWord(struct tokens*,char*);
+int operatorAt(char*,int);
+
+
+/* addWord
+ *
+ * addWord returns nothing, it appends word to the words of t, making
+ * room for it first if the array is full.
+ *
+ * @param    struct tokens * t
+ * @param    char * word
+ */
+void addWord(struct tokens * t,char * word)
+{
+  if(t->num_words == t->max_words){
+    t->max_words = t->max_words ? 2 * t->max_words : 16;
+    t->words = realloc(t->words,t->max_words * sizeof(char *));
+  }
+  t->words[t->num_words++] = word;
+}
+
+
+/* freeTokens
+ *
+ * freeTokens returns nothing, it frees the arrays of t.
+ *
+ * @param    struct tokens * t
+ */
+void freeTokens(struct tokens * t)
+{
+  free(t->words);
+  free(t->arena);
+  memset(t,'\0',sizeof(*t));
+}
+
+
+/* isOperator
+ *
+ * isOperator returns 1 if word is one of the operators returned by
+ * tokenize, and 0 if it is a word, even one that reads like one.
+ *
+ * @param    char * word
+ */
+int isOperator(char * word)
+{
+  int i;
+
+  for(i=0;operators[i] != NULL;i++){
+    if(word == operators[i]){
+      return 1;
+    }
+  }
+  return 0;
+}
+
+
+/* operatorAt
+ *
+ * operatorAt returns the index in operators plus one of the operator
+ * that starts at p, or 0 if there is none. 2> is only an operator at
+ * the start of a word, in_word is 1 in the middle of one.
+ *
+ * @param    char * p
+ * @param    int in_word
+ */
+int operatorAt(char * p,int in_word)
+{
+  int i;
+
+  for(i=0;operators[i] != NULL;i++){ /* Inga operatorer är längre än två tecken. */
+    if(operators[i][0] == p[0] && ('\0' == operators[i][1] || operators[i][1] == p[1])){
+      return (OP_ERROR == operators[i] && in_word) ? 0 : i + 1;
+    }
+  }
+  return 0;
+}
+
+
+/* tokenize
+ *
+ * tokenize returns the number of words and operators in line, which
+ * it puts in t->words followed by NULL, or -1 if a quote is not
+ * closed. Words point into t->arena, operators are the pointers in
+ * operators. The arena needs at most a byte for every byte of line
+ * and one for the \0 of every word, it is made that big at once.
+ *
+ * @param    struct tokens * t
+ * @param    char * line
+ */
+int tokenize(struct tokens * t,char * line)
+{
+  size_t len = strlen(line);
+  char *p, *out, *start = NULL;
+  char quote = '\0'; /* ' eller " inom citattecken. */
+  int in_word = 0, op;
+
+  if(t->arena_size < 2 * len + 1){
+    t->arena_size = 2 * len + 1;
+    free(t->arena);
+    t->arena = malloc(t->arena_size);
+  }
+  out = t->arena;
+  t->num_words = 0;
+
+  for(p=line;;p++){
+    if('\'' == quote){
+      if('\0' == *p){
+        return -1;
+      }
+      if('\'' == *p){
+        quote = '\0';
+      }else{
+        *out++ = *p;
+      }
+      continue;
+    }
+    if('"' == quote){
+      if('\0' == *p){
+        return -1;
+      }
+      if('"' == *p){
+        quote = '\0';
+      }else if('\\' == *p && '\0' != p[1] && NULL != strchr("\"\\$`\n",p[1])){
+        if('\n' != *++p){
+          *out++ = *p;
+        }
+      }else{
+        *out++ = *p;
+      }
+      continue;
+    }
+
+    /* Utanför citattecken avslutar blanktecken och operatorer ordet. */
+    if(!special[(unsigned char) *p]){ /* Det vanliga fallet, ett tecken i ett ord. */
+      if(!in_word){
+        start = out;
+        in_word = 1;
+      }
+      *out++ = *p;
+      continue;
+    }
+    if('\\' == *p && '\n' == p[1]){ /* Fortsättningsrad. */
+      p++;
+      continue;
+    }
+    op = operatorAt(p,in_word);
+    if('\0' == *p || ' ' == *p || '\t' == *p || '\n' == *p || op){
+      if(in_word){
+        *out++ = '\0';
+        addWord(t,start);
+        in_word = 0;
+      }
+      if('\0' == *p){
+        break;
+      }
+      if(op){
+        addWord(t,operators[op-1]);
+        p += ('\0' != operators[op-1][1]);
+      }
+      continue;
+    }
+    if(!in_word){
+      start = out;
+      in_word = 1;
+    }
+    if('\\' == *p && '\0' != p[1]){
+      *out++ = *++p;
+    }else if('\'' == *p || '"' == *p){
+      quote = *p;
+    }else{
+      *out++ = *p;
+    }
+  }
+  addWord(t,NULL);
+  return --t->num_words;
+}
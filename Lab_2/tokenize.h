@@ -0,0 +1,30 @@
+#ifndef _tokenize_h_
+#define _tokenize_h_
+
+#include <stddef.h>
+
+/* The words of a command line, see tokenize in tokenize.c. The
+ * arrays grow as needed and are reused from one line to the next. */
+struct tokens {
+  char **words;                         /* ends with NULL */
+  int num_words;
+  int max_words;
+  char *arena;                          /* the text of the words, each ending with \0 */
+  size_t arena_size;
+};
+
+/* Operators are returned as these very pointers, a quoted | is a word. */
+extern char *operators[];
+
+#define OP_APPEND     (operators[0])    /* >> */
+#define OP_ERROR      (operators[1])    /* 2> */
+#define OP_PIPE       (operators[2])    /* | */
+#define OP_INPUT      (operators[3])    /* < */
+#define OP_OUTPUT     (operators[4])    /* > */
+#define OP_BACKGROUND (operators[5])    /* & */
+
+int tokenize(struct tokens*,char*);
+int isOperator(char*);
+void freeTokens(struct tokens*);
+
+#endif
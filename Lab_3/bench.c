@@ -0,0 +1,423 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+#ifdef THREADS
+#include <pthread.h>
+#endif
+#ifdef ARENA
+#include "malloc.h"
+#endif
+
+/* Build with 'gcc -O2 malloc.c bench.c', or without malloc.c to measure
+ * the libc malloc, see bench.sh. Add -DTHREADS -lpthread for the
+ * producer/consumer scenario and, with malloc.c, -DARENA to compare
+ * the request scenario with an arena. Every call is timed on its own with the
+ * monotonic clock, one line per scenario and operation is printed:
+ *
+ *    allocator scenario op count mean p50 p99 p999 max total_ms faults dtlb_misses
+ *
+ * with the times in ns, tab separated. The "timer" line is what an
+ * empty measurement costs, it is included in every other figure.
+ * faults (minor and major) and dtlb_misses (data TLB read misses in
+ * user mode, "-" where perf_event_open is not allowed) are counted
+ * over the timed part of the whole scenario, so they are the same on
+ * each of its lines and include what the scenario itself touches.
+ */
+
+#define NALLOC 1024                                     /* as in malloc.c */
+#ifndef N
+#define N 1000000                                       /* operations per scenario, see testfall */
+#endif
+#define WARMUP (N/10)                                   /* untimed operations first */
+#define LIVE 1000                                       /* blocks alive at a time */
+#define VECTORS 16                                      /* grown side by side by realloc */
+#define MAXVECTOR (256*1024)
+#define RING 4096                                       /* producer/consumer queue */
+#define REQUEST 1000                                    /* objects all freed together */
+#define FRAGMENTS 100000                                /* free blocks in the fragmented heap */
+
+struct series {
+  const char *op;
+  long long *ns;                                        /* one sample per call */
+  size_t n;
+  long long total;
+};
+
+static const char *label = "bench";
+static struct series mallocs = { "malloc" }, frees = { "free" }, reallocs = { "realloc" };
+static struct series arenaAllocs = { "arena_alloc" }, resets = { "arena_reset" };
+static unsigned long seed = 1;
+static long faults;                                     /* of the last scenario */
+static long long misses;
+static int tlbFd = -1;
+
+static long long now(void){
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec*1000000000LL + ts.tv_nsec;
+}
+
+/* The benchmark's own memory is mapped so it never touches the allocator. */
+static void * mapArray(size_t bytes){
+  void *p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+  if(p == MAP_FAILED){
+    perror("bench");
+    exit(1);
+  }
+  return p;
+}
+
+static long faultCount(void){
+  struct rusage ru;
+
+  getrusage(RUSAGE_SELF, &ru);
+  return ru.ru_minflt + ru.ru_majflt;
+}
+
+/* Opens the data TLB read miss counter of this process, if allowed. */
+static void openTlb(void){
+#ifdef __linux__
+  struct perf_event_attr pe;
+
+  memset(&pe, 0, sizeof(pe));
+  pe.size = sizeof(pe);
+  pe.type = PERF_TYPE_HW_CACHE;
+  pe.config = PERF_COUNT_HW_CACHE_DTLB | PERF_COUNT_HW_CACHE_OP_READ << 8
+              | PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+  pe.exclude_kernel = 1;
+  pe.exclude_hv = 1;
+  pe.inherit = 1;                                       /* the consumer thread too */
+  tlbFd = syscall(SYS_perf_event_open, &pe, 0, -1, -1, 0);
+#endif
+}
+
+/* Returns the misses so far, or -1 without a counter. */
+static long long tlbCount(void){
+  long long n;
+
+  if(tlbFd < 0 || read(tlbFd, &n, sizeof(n)) != sizeof(n))
+    return -1;
+  return n;
+}
+
+static unsigned long rnd(void){
+  seed = seed*6364136223846793005UL + 1442695040888963407UL;
+  return seed >> 33;
+}
+
+static size_t smallSize(size_t i){ return NALLOC; }
+static size_t largeSize(size_t i){ return 100*NALLOC; }
+
+/* Mostly small, now and then up to 128 KiB: the bound is a power of two
+ * from 8 to 128 Ki picked at random. */
+static size_t mixedSize(size_t i){
+  return 8 + rnd() % (1UL << (3 + rnd() % 15));
+}
+
+static void record(struct series *s, long long t){
+  if(s->ns != NULL){
+    s->ns[s->n++] = t;
+    s->total += t;
+  }
+}
+
+static int cmp(const void *a, const void *b){
+  long long x = *(const long long *)a, y = *(const long long *)b;
+
+  return x < y ? -1 : x > y;
+}
+
+static void report(const char *scenario, struct series *s){
+  char tlb[32] = "-";
+
+  if(s->n == 0)
+    return;
+  qsort(s->ns, s->n, sizeof(long long), cmp);
+  if(misses >= 0)
+    snprintf(tlb, sizeof(tlb), "%lld", misses);
+  printf("%s\t%s\t%s\t%zu\t%lld\t%lld\t%lld\t%lld\t%lld\t%.1f\t%ld\t%s\n", label, scenario, s->op,
+         s->n, s->total/(long long)s->n, s->ns[(s->n-1)/2], s->ns[(s->n-1)*99/100],
+         s->ns[(s->n-1)*999/1000], s->ns[s->n-1], s->total/1e6, faults, tlb);
+  s->n = 0;
+  s->total = 0;
+}
+
+/* Rounds of LIVE mallocs followed by LIVE frees, like tstmalloc.c. With
+ * shuffle the frees come in random order and leave holes behind. */
+static void blocks(size_t ops, size_t (*size)(size_t), int shuffle){
+  static char *array[LIVE];
+  size_t done, i, j, nbytes;
+  long long t;
+  char *tmp;
+
+  for(done = 0; done < ops; done += LIVE){
+    for(i = 0; i < LIVE; i++){
+      nbytes = size(i);
+      t = now();
+      array[i] = malloc(nbytes);
+      record(&mallocs, now() - t);
+      if(array[i] == NULL){
+        fprintf(stderr, "%s: malloc(%zu) returned NULL\n", label, nbytes);
+        exit(1);
+      }
+      array[i][0] = array[i][nbytes-1] = 1;
+    }
+    if(shuffle)
+      for(i = LIVE-1; i > 0; i--){
+        j = rnd() % (i+1);
+        tmp = array[i]; array[i] = array[j]; array[j] = tmp;
+      }
+    for(i = 0; i < LIVE; i++){
+      t = now();
+      free(array[i]);
+      record(&frees, now() - t);
+    }
+  }
+}
+
+/* Requests of REQUEST objects of up to 256 bytes, freed one by one
+ * when the request is done. */
+static void request(size_t ops){
+  static char *array[REQUEST];
+  size_t done, i, nbytes;
+  long long t;
+
+  for(done = 0; done < ops; done += REQUEST){
+    for(i = 0; i < REQUEST; i++){
+      nbytes = 16 + rnd() % 241;
+      t = now();
+      array[i] = malloc(nbytes);
+      record(&mallocs, now() - t);
+      if(array[i] == NULL){
+        fprintf(stderr, "%s: malloc(%zu) returned NULL\n", label, nbytes);
+        exit(1);
+      }
+      array[i][0] = array[i][nbytes-1] = 1;
+    }
+    for(i = 0; i < REQUEST; i++){
+      t = now();
+      free(array[i]);
+      record(&frees, now() - t);
+    }
+  }
+}
+
+/* FRAGMENTS free blocks of 320 to 1024 bytes, kept apart by blocks
+ * in use, so every malloc has to pick one of them. Each is freed
+ * again at once and the heap stays the same. A search costs as much
+ * as a scan of the free list for some strategies, so only ops/1000
+ * calls are made. */
+static void fragmented(size_t ops){
+  static char *holes[FRAGMENTS], *walls[FRAGMENTS];
+  size_t i, nbytes;
+  long long t;
+  char *p;
+
+  for(i = 0; i < FRAGMENTS; i++){
+    holes[i] = malloc(320 + rnd() % 705);
+    walls[i] = malloc(300);
+    if(holes[i] == NULL || walls[i] == NULL){
+      fprintf(stderr, "%s: malloc returned NULL\n", label);
+      exit(1);
+    }
+  }
+  for(i = 0; i < FRAGMENTS; i++)
+    free(holes[i]);
+  for(i = 0; i < ops/1000; i++){
+    nbytes = 320 + rnd() % 705;
+    t = now();
+    p = malloc(nbytes);
+    record(&mallocs, now() - t);
+    if(p == NULL){
+      fprintf(stderr, "%s: malloc(%zu) returned NULL\n", label, nbytes);
+      exit(1);
+    }
+    p[0] = p[nbytes-1] = 1;
+    t = now();
+    free(p);
+    record(&frees, now() - t);
+  }
+  for(i = FRAGMENTS; i-- > 0; )                        /* carved top down, so lowest address first */
+    free(walls[i]);
+}
+
+#ifdef ARENA
+/* The same requests taken from an arena that is reset when done. */
+static void requestArena(size_t ops){
+  static struct arena *a;
+  size_t done, i, nbytes;
+  long long t;
+  char *p;
+
+  if(a == NULL && (a = arena_create(0)) == NULL){
+    fprintf(stderr, "%s: arena_create returned NULL\n", label);
+    exit(1);
+  }
+  for(done = 0; done < ops; done += REQUEST){
+    for(i = 0; i < REQUEST; i++){
+      nbytes = 16 + rnd() % 241;
+      t = now();
+      p = arena_alloc(a, nbytes);
+      record(&arenaAllocs, now() - t);
+      if(p == NULL){
+        fprintf(stderr, "%s: arena_alloc(%zu) returned NULL\n", label, nbytes);
+        exit(1);
+      }
+      p[0] = p[nbytes-1] = 1;
+    }
+    t = now();
+    arena_reset(a);
+    record(&resets, now() - t);
+  }
+}
+#endif
+
+/* VECTORS areas grown by half at a time side by side, so they get in
+ * each other's way, until ops reallocs have been made. */
+static void growth(size_t ops){
+  char *v[VECTORS];
+  size_t len[VECTORS];
+  size_t done = 0, i, nbytes;
+  long long t;
+  char *p;
+
+  memset(len, 0, sizeof(len));
+  memset(v, 0, sizeof(v));
+  while(done < ops){
+    for(i = 0; i < VECTORS && done < ops; i++, done++){
+      nbytes = len[i] + len[i]/2 + 16;
+      t = now();
+      p = realloc(v[i], nbytes);
+      record(&reallocs, now() - t);
+      if(p == NULL){
+        fprintf(stderr, "%s: realloc(%zu) returned NULL\n", label, nbytes);
+        exit(1);
+      }
+      p[nbytes-1] = 1;
+      v[i] = p;
+      len[i] = nbytes;
+      if(len[i] > MAXVECTOR){
+        free(v[i]);
+        v[i] = NULL;
+        len[i] = 0;
+      }
+    }
+  }
+  for(i = 0; i < VECTORS; i++)
+    free(v[i]);
+}
+
+#ifdef THREADS
+static char *ring[RING];
+static size_t head, tail;                               /* written by producer and consumer only */
+
+/* The producer mallocs, the consumer in another thread frees. */
+static void * consumer(void *arg){
+  size_t ops = *(size_t *)arg, i;
+  long long t;
+  char *p;
+
+  for(i = 0; i < ops; i++){
+    while(__atomic_load_n(&head, __ATOMIC_ACQUIRE) == tail)
+      ;
+    p = ring[tail % RING];
+    __atomic_store_n(&tail, tail+1, __ATOMIC_RELEASE);
+    t = now();
+    free(p);
+    record(&frees, now() - t);
+  }
+  return NULL;
+}
+
+static void producer(size_t ops){
+  pthread_t tid;
+  size_t i, nbytes;
+  long long t;
+  char *p;
+
+  head = tail = 0;
+  pthread_create(&tid, NULL, consumer, &ops);
+  for(i = 0; i < ops; i++){
+    nbytes = mixedSize(i);
+    t = now();
+    p = malloc(nbytes);
+    record(&mallocs, now() - t);
+    if(p == NULL){
+      fprintf(stderr, "%s: malloc(%zu) returned NULL\n", label, nbytes);
+      exit(1);
+    }
+    p[0] = 1;
+    while(head - __atomic_load_n(&tail, __ATOMIC_ACQUIRE) == RING)
+      ;
+    ring[head % RING] = p;
+    __atomic_store_n(&head, head+1, __ATOMIC_RELEASE);
+  }
+  pthread_join(tid, NULL);
+}
+#endif
+
+/* Runs a scenario WARMUP operations untimed, then N timed. */
+#define SCENARIO(name, call) do {                             \
+    struct series *all[] = { &mallocs, &frees, &reallocs,     \
+                             &arenaAllocs, &resets };         \
+    size_t ops = WARMUP;                                      \
+    unsigned k;                                               \
+    for(k = 0; k < 5; k++) all[k]->ns = NULL;                 \
+    call;                                                     \
+    ops = N;                                                  \
+    for(k = 0; k < 5; k++) all[k]->ns = samples[k];           \
+    faults = faultCount();                                    \
+    misses = tlbCount();                                      \
+    call;                                                     \
+    faults = faultCount() - faults;                           \
+    misses = misses < 0 ? -1 : tlbCount() - misses;           \
+    for(k = 0; k < 5; k++) report(name, all[k]);              \
+  } while(0)
+
+int main(int argc, char *argv[]){
+  long long *samples[5];
+  long long t;
+  size_t i;
+
+  if(argc > 1)
+    label = argv[1];
+  setvbuf(stdout, NULL, _IOLBF, 0);                     /* lines show up as scenarios end */
+  for(i = 0; i < 5; i++)
+    samples[i] = mapArray(N*sizeof(long long));
+  openTlb();
+
+  mallocs.ns = samples[0];
+  mallocs.op = "timer";
+  for(i = 0; i < N; i++){
+    t = now();
+    record(&mallocs, now() - t);
+  }
+  faults = 0;
+  misses = -1;
+  report("-", &mallocs);
+  mallocs.op = "malloc";
+
+  SCENARIO("small", blocks(ops, smallSize, 0));
+  SCENARIO("large", blocks(ops, largeSize, 0));
+  SCENARIO("mixed", blocks(ops, mixedSize, 1));
+  SCENARIO("realloc", growth(ops));
+  SCENARIO("request", request(ops));
+  SCENARIO("fragmented", fragmented(ops));
+#ifdef ARENA
+  SCENARIO("request", requestArena(ops));
+#endif
+#ifdef THREADS
+  SCENARIO("producer-consumer", producer(ops));
+#endif
+  return 0;
+}
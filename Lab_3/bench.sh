@@ -0,0 +1,49 @@
+#!/bin/bash
+
+# Runs bench.c against every STRATEGY, against the same with THREADS and
+# against the libc malloc (as tstSysMalloc.c does). The request scenario
+# is also run with an arena for all but the libc malloc. The output is tab
+# separated with a header line, times in ns, e.g. './bench.sh > bench.tsv'.
+
+echo -e "allocator\tscenario\top\tcount\tmean\tp50\tp99\tp999\tmax\ttotal_ms\tfaults\tdtlb_misses"
+
+gcc -O2 -DTHREADS -o bench bench.c -lpthread || exit 1
+./bench glibc
+for STRATEGY in 1 2 3 4 5
+do
+   gcc -O2 -DSTRATEGY=$STRATEGY -DARENA -o bench malloc.c bench.c || exit 1
+   ./bench strategy$STRATEGY
+done
+gcc -O2 -DTHREADS -DARENA -o bench malloc.c bench.c -lpthread || exit 1
+./bench threads
+# With boundary tags big free blocks are kept in a size tree, compare
+# it with searching the free list (-DTREE_MIN=0).
+for STRATEGY in 1 2 3
+do
+   gcc -O2 -DSTRATEGY=$STRATEGY -DBOUNDARY_TAGS -DARENA -o bench malloc.c bench.c || exit 1
+   ./bench strategy$STRATEGY-tree
+   gcc -O2 -DSTRATEGY=$STRATEGY -DBOUNDARY_TAGS -DTREE_MIN=0 -DARENA -o bench malloc.c bench.c || exit 1
+   ./bench strategy$STRATEGY-list
+done
+# Heaps of huge pages, transparent (1) or from the MAP_HUGETLB pool (2),
+# compare their faults and TLB misses with those of strategy1.
+for HUGEPAGES in 1 2
+do
+   gcc -O2 -DSTRATEGY=1 -DHUGEPAGES=$HUGEPAGES -DARENA -o bench malloc.c bench.c || exit 1
+   ./bench hugepages$HUGEPAGES
+done
+# Each of the checks of -DCHECKS on its own and all of them, compare
+# them with strategy1 to see what leaving them on would cost.
+for CHECKS in 1 2 4 7
+do
+   gcc -O2 -DCHECKS=$CHECKS -DARENA -o bench malloc.c bench.c || exit 1
+   ./bench checks$CHECKS
+done
+# Frees held back on quick lists and joined to the free list in
+# batches, compare with strategy1 and strategy4.
+for STRATEGY in 1 4
+do
+   gcc -O2 -DSTRATEGY=$STRATEGY -DBOUNDARY_TAGS -DDEFER_FREE=1024 -DARENA -o bench malloc.c bench.c || exit 1
+   ./bench deferred$STRATEGY
+done
+rm -f bench
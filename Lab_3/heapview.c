@@ -0,0 +1,179 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Reads a heap map written by malloc_heapmap in malloc.c, or for a
+ * running process by sending it SIGUSR2 with MALLOC_HEAPMAP set, e.g.
+ *
+ *    gcc -O2 -shared -fPIC -DTHREADS -o libmalloc.so malloc.c -lpthread
+ *    MALLOC_HEAPMAP=/tmp/heap LD_PRELOAD=./libmalloc.so ./server &
+ *    kill -USR2 $!
+ *    ./heapview /tmp/heap.<pid>.0
+ *
+ * Build it on its own: 'gcc -O2 -o heapview heapview.c'. It prints the
+ * totals, a histogram of free block sizes, and for every region its
+ * occupancy and a picture of it, one character per -s bytes (by
+ * default what fits the whole heap into about 32 lines of -w, 64,
+ * characters):
+ *
+ *    # all in use   = mostly in use   - mostly free   . all free
+ *
+ * Without a file name the map is read from standard input.
+ */
+
+#define NSIZES 24                                       /* as in malloc.c */
+
+static size_t width = 64, scale = 0;
+static size_t freeBytes = 0, usedBytes = 0, freeBlocks = 0, largest = 0, heap = 0;
+static unsigned long sizes[NSIZES];
+
+static unsigned sizeClass(size_t nbytes){
+  unsigned i = 0;
+
+  while(i < NSIZES-1 && nbytes > (size_t) 16 << i)
+    i++;
+  return i;
+}
+
+/* One character of the picture covers scale bytes, free of them free. */
+static size_t cellFree = 0, cellUsed = 0, column = 0;
+
+static void cellPut(void){
+  if(cellFree + cellUsed == 0)
+    return;
+  putchar(cellFree == 0 ? '#' : cellUsed == 0 ? '.' : cellFree < cellUsed ? '=' : '-');
+  cellFree = cellUsed = 0;
+  if(++column == width){
+    putchar('\n');
+    column = 0;
+  }
+}
+
+static void draw(size_t bytes, int isFree){
+  size_t take;
+
+  while(bytes > 0){
+    take = scale - (cellFree + cellUsed);
+    if(take > bytes)
+      take = bytes;
+    if(isFree)
+      cellFree += take;
+    else
+      cellUsed += take;
+    bytes -= take;
+    if(cellFree + cellUsed == scale)
+      cellPut();
+  }
+}
+
+/* Reads the runs line of a region, adding it to the totals, or with
+ * picture set drawing it. */
+static void runs(FILE *in, size_t unit, int picture){
+  long n;
+  int c;
+
+  for(;;){
+    while((c = getc(in)) == ' ')
+      ;
+    if(c == '\n' || c == EOF)
+      break;
+    ungetc(c, in);
+    if(fscanf(in, "%ld", &n) != 1)
+      break;
+    if(picture)
+      draw((n < 0 ? -n : n)*unit, n < 0);
+    else if(n < 0){
+      freeBlocks++;
+      freeBytes += -n*unit;
+      sizes[sizeClass(-n*unit)]++;
+      if(-n*unit > largest)
+        largest = -n*unit;
+    }
+    else
+      usedBytes += n*unit;
+  }
+  if(picture){
+    cellPut();
+    if(column > 0)
+      putchar('\n');
+    column = 0;
+  }
+}
+
+int main(int argc, char *argv[]){
+  FILE *in;
+  char line[256];
+  size_t unit, nregions, i, start, bytes, used, rfree, rblocks, rlargest;
+  long where;
+  int c;
+
+  while((c = getopt(argc, argv, "w:s:")) != -1)
+    switch(c){
+    case 'w': width = strtoul(optarg, NULL, 0); break;
+    case 's': scale = strtoul(optarg, NULL, 0); break;
+    default:
+      fprintf(stderr, "usage: %s [-w width] [-s bytes] [map]\n", argv[0]);
+      return 2;
+    }
+  if(optind < argc){
+    if((in = fopen(argv[optind], "r")) == NULL){
+      perror(argv[optind]);
+      return 1;
+    }
+  }
+  else if((in = tmpfile()) != NULL){                   /* it is read twice */
+    while((c = getchar()) != EOF)
+      putc(c, in);
+    rewind(in);
+  }
+  else {
+    perror(argv[0]);
+    return 1;
+  }
+  if(fgets(line, sizeof(line), in) == NULL
+     || sscanf(line, "heapmap\t%zu\t%zu", &unit, &nregions) != 2){
+    fprintf(stderr, "%s: not a heap map\n", argv[0]);
+    return 1;
+  }
+  if(width == 0)
+    width = 64;
+
+  /* The totals come first, the region lines have what the scale needs. */
+  where = ftell(in);
+  for(i = 0; i < nregions && fgets(line, sizeof(line), in) != NULL; i++){
+    if(sscanf(line, "region\t%zx\t%zu", &start, &bytes) != 2)
+      break;
+    heap += bytes;
+    runs(in, unit, 0);
+  }
+  if(scale == 0)
+    scale = (heap/(width*32) + unit-1)/unit*unit;
+  if(scale == 0)
+    scale = unit;
+  printf("regions         %zu, %zu bytes\n", nregions, heap);
+  printf("in use          %zu bytes\n", usedBytes);
+  printf("free            %zu bytes in %zu blocks, largest %zu\n", freeBytes, freeBlocks, largest);
+  printf("fragmentation   %.1f%%\n", freeBytes ? 100.0*(freeBytes - largest)/freeBytes : 0.0);
+  printf("free block sizes\n");
+  for(i = 0; i < NSIZES; i++)
+    if(sizes[i] != 0){
+      if(i < NSIZES-1)
+        printf("  <= %-10zu  %lu\n", (size_t) 16 << i, sizes[i]);
+      else
+        printf("   > %-10zu  %lu\n", (size_t) 16 << (i-1), sizes[i]);
+    }
+
+  /* Then every region on its own, which needs a second pass. */
+  fseek(in, where, SEEK_SET);
+  printf("one character is %zu bytes:  # all in use   = mostly in use   - mostly free   . all free\n", scale);
+  for(i = 0; i < nregions && fgets(line, sizeof(line), in) != NULL; i++){
+    if(sscanf(line, "region\t%zx\t%zu\t%zu\t%zu\t%zu\t%zu",
+              &start, &bytes, &used, &rfree, &rblocks, &rlargest) != 6)
+      break;
+    printf("region %#zx   %zu bytes, %.1f%% in use, %zu free in %zu blocks, largest %zu\n",
+           start, bytes, bytes ? 100.0*used/bytes : 0.0, rfree, rblocks, rlargest);
+    runs(in, unit, 1);
+  }
+  return 0;
+}
@@ -6,19 +6,153 @@
  * SYNOPSIS:
  *    malloc (size_t nbytes)
  *    realloc (void *ptr, size_t size)
+ *    calloc (size_t nmemb, size_t size)
  *    free (void *ap)
+ *    posix_memalign (void **memptr, size_t alignment, size_t size)
+ *    aligned_alloc (size_t alignment, size_t size)
+ *    memalign (size_t alignment, size_t size)
+ *    valloc (size_t size)
+ *    pvalloc (size_t size)
+ *    malloc_usable_size (void *ap)
+ *    malloc_trim (size_t pad)
+ *    pool_create (size_t size)
+ *    pool_alloc (struct pool *pool)
+ *    pool_free (struct pool *pool, void *obj)
+ *    pool_destroy (struct pool *pool)
+ *    arena_create (size_t size)
+ *    arena_alloc (struct arena *a, size_t nbytes)
+ *    arena_save (struct arena *a)
+ *    arena_restore (struct arena *a, struct arena_mark m)
+ *    arena_reset (struct arena *a)
+ *    arena_destroy (struct arena *a)
+ *    mallinfo2 (void)
+ *    malloc_stats (void)
+ *    malloc_heapinfo (struct malloc_heapinfo *hi)
+ *    malloc_heapmap (int fd)
  *
- *    Consider 'gcc -DStrategy=[1,3] malloc.c' for different memory allocation methods.
+ *    Consider 'gcc -DSTRATEGY=[0,1,2,3,4,5] malloc.c' for different memory allocation methods.
+ *
+ *    To use it in place of the libc allocator in an existing program, build a shared library
+ *    and preload it:
+ *
+ *       gcc -O2 -shared -fPIC -DTHREADS -o libmalloc.so malloc.c -lpthread
+ *       LD_PRELOAD=./libmalloc.so ls -l
  *
  * DESCRIPTION:
  *    Malloc is a dynamic memory manager for Unix-like systems and includes the functions
  *    malloc, realloc and free. The original code stems from K&R, see author for reference.
- *    Contributions include a realloc and two different memory allocation methods, First Fit
- *    and Worst Fit. The default algortithm is First Fit but you can also explicitly choose
- *    an algorithm via the compilation flag -D with STRATEGY assigned either:
+ *    Contributions include a realloc and five different memory allocation methods, First Fit,
+ *    Best Fit, Worst Fit, Segregated Fit and Next Fit. The default algortithm is First Fit but
+ *    you can also explicitly choose an algorithm via the compilation flag -D with STRATEGY
+ *    assigned either:
+ *
+ *    0 , pick 1, 2, 3 or 5 at startup from the environment variable MALLOC_STRATEGY, which
+ *        holds the number or first, best, worst or next,
+ *    1 , which is the default First Fit,
+ *    2 , the Best Fit algorithm,
+ *    3 , the Worst Fit algorithm,
+ *    4 , Segregated Fit, where free blocks are kept in per size-class bins. Small requests
+ *        have one exact bin per unit count and are served in O(1), larger requests only
+ *        search the power-of-two range they belong to, or
+ *    5 , Next Fit, which resumes the search where the last one ended.
+ *
+ *    A block in use only carries a word with its size in units of 16 bytes and a few flags,
+ *    blocks start 8 bytes before a 16 byte boundary so the payload is aligned, and the free
+ *    list link lives in the payload while the block is free. A request of n bytes takes
+ *    (n + 8)/16 units rounded up, and sizes are size_t throughout, so blocks of more than
+ *    4 GiB work like any other.
+ *
+ *    realloc works in place where it can. A shrinking block gives its tail back to the free
+ *    list, and a growing block takes over the free block right above it, asking morecore
+ *    for more memory if it sits at the top of the heap. Only otherwise is the data copied.
+ *
+ *    Requests of MMAP_THRESHOLD bytes (128 KiB by default, set with -DMMAP_THRESHOLD=n where
+ *    0 turns it off) or more never touch the free list. Each gets a mapping of its own,
+ *    which free hands back to the system with munmap and realloc resizes with mremap.
+ *
+ *    Free memory is given back to the system once a free block reaches TRIM_THRESHOLD bytes
+ *    (128 KiB by default, -DTRIM_THRESHOLD=0 turns it off, MALLOC_TRIM_THRESHOLD in the
+ *    environment overrides it). Pages at the top of the heap are unmapped, or returned with
+ *    sbrk, and whole pages inside other free blocks are released with madvise(MADV_DONTNEED).
+ *    malloc_trim(pad) does the same for every free block at once, keeping pad bytes on top.
+ *
+ *    Compiling with -DBOUNDARY_TAGS gives every block a "free" and a "previous block free"
+ *    flag, and free blocks a footer holding their size. free then finds and joins its
+ *    physical neighbours in constant time, and the free lists become doubly linked and
+ *    unordered instead of sorted by address. It can be combined with any STRATEGY, and
+ *    Segregated Fit always has it, as its bins could not join free blocks otherwise.
+ *    Free blocks of TREE_MIN bytes (256 by default, -DTREE_MIN=0 turns it off) or more are
+ *    then kept in a tree ordered by size and address instead, as they are with Segregated
+ *    Fit, so Best and Worst Fit, and any search for a big block, take O(log n). The address
+ *    ordered list of the other strategies is left alone, free walks it anyway.
+ *
+ *    -DDEFER_FREE=n makes free hold blocks back on quick lists, one per unit count up to
+ *    2 KiB, from which malloc takes them again in O(1) for a request of the same size. Once
+ *    n blocks wait, or a request finds no free block, they are sorted by address and joined
+ *    to the free list in a single sweep, which a burst of frees would otherwise walk once
+ *    each. mallinfo2, malloc_stats, the heap walks and malloc_trim consolidate first.
+ *
+ *    Compiling with -DTHREADS (and linking with -lpthread) makes the manager thread-safe.
+ *    Each thread keeps a cache of recently freed small blocks per unit count, which
+ *    malloc and free use without locking. Misses, bigger blocks and cache overflow go to
+ *    the shared arena behind a mutex, refilling a few blocks of the same size at a time.
+ *    Blocks the caches give back are deferred or trimmed there like any other free.
+ *
+ *    With MMAP defined in brk.h, morecore reserves MMAP_RESERVE bytes (64 MiB by default) of
+ *    private address space at a time and commits it in chunks that double on every call,
+ *    so a growing heap costs few system calls. -DMMAP_RESERVE=0 maps every chunk on its own.
+ *    -DHUGEPAGES=1 reserves the heap at 2 MiB boundaries in whole huge pages and asks for
+ *    transparent huge pages with madvise(MADV_HUGEPAGE), as it does for big mapped blocks.
+ *    -DHUGEPAGES=2 takes the heap from the MAP_HUGETLB pool instead, and falls back to the
+ *    former once the pool is too small. Memory is then only trimmed in whole huge pages.
+ *
+ *    Objects of a fixed size can be taken from a pool: pool_create(size) makes one, and
+ *    pool_alloc and pool_free take and give back objects with no header of their own. They
+ *    are cut from page sized slabs in a region of SLAB_RESERVE bytes (256 MiB by default) of
+ *    address space kept for slabs, and the slab an object belongs to is found from its page.
+ *    malloc serves requests of up to SLAB_MAX bytes (256 by default, -DSLAB_MAX=0 turns it
+ *    off) from pools of its own, one per multiple of 16 bytes, and only uses the free list
+ *    when the slab region is used up. With THREADS those objects are cached per thread too.
+ *
+ *    Memory that is all freed at once can be taken from an arena instead: arena_alloc only
+ *    bumps a pointer through chunks from the heap, which double in size as they fill up.
+ *    arena_save marks how far it has got and arena_restore goes back to the mark, arena_reset
+ *    empties it and arena_destroy frees it, each by freeing the chunks and not the objects.
+ *
+ *    The manager counts what it does: morecore calls, free list searches and the blocks they
+ *    look at, joins, mapped blocks, thread cache hits and a histogram of request sizes.
+ *    Counters on the lock-free paths are kept per thread and summed when read, the rest
+ *    are only touched under the arena lock, and the free lists are walked when read rather
+ *    than counted by malloc and free. mallinfo2() returns them in the glibc layout and
+ *    malloc_stats() prints them, as happens at exit when MALLOC_STATS is set in the
+ *    environment. -DSTATS=0 compiles the counters out, mallinfo2 then returns zeroes and
+ *    malloc_stats says the statistics are compiled out.
+ *
+ *    With the counters come heap walks. morecore keeps a table of the regions it got, and
+ *    malloc_heapinfo walks them block by block for the occupancy, the largest free block,
+ *    the share of free memory outside it and a histogram of free block sizes.
+ *    malloc_heapmap writes the walk to a file as a compact text map, with a line per region
+ *    and its runs of blocks in use and free, which heapview.c prints and draws. With
+ *    MALLOC_HEAPMAP in the environment, SIGUSR2 makes a running process write one. Only a
+ *    copy of the block sizes is made under the arena lock, the rest is done from the copy.
+ *    With -DSTATS=0 both fail with ENOSYS.
+ *
+ *    -DCHECKS=n turns on checks of the pointers given to free and realloc, n being the sum of
+ *    1 , the pointer has to lie in the heap, be a mapped block (these are kept in a hash
+ *        table for the check), or be an object of a slab,
+ *    2 , the header of a block in use is sealed with a keyed hash of its address and size,
+ *        in 16 bits the size gives up, and a freed slab object is marked, which tells
+ *        double frees and corrupt headers apart, and
+ *    4 , freed memory is filled with the byte POISON (0xdf).
+ *    A failed check prints what was wrong and aborts. bench.sh measures what each one costs.
  *
- *    1 , which is the default First Fit, or
- *    3 , the Worst Fit algorithm.
+ *    Compiled with -DTRACE every call is recorded to the file named by MALLOC_TRACE in the
+ *    environment with the pid added, e.g. ls.trace.1234 for MALLOC_TRACE=ls.trace, in the
+ *    binary format of trace.h. Each thread buffers TRACE_BATCH records and writes them at
+ *    once, a sequence number puts the threads back in order. A program started by the traced
+ *    one under LD_PRELOAD writes a trace of its own. replay.c makes the same calls against
+ *    any build of this file, or against libc, and reports the time taken, peak RSS and
+ *    fragmentation.
  *
  * EXAMPLES:
  *    char *p;
@@ -42,6 +176,9 @@
  */
 
 
+#ifdef __linux__
+#define _GNU_SOURCE                                     /* for mremap */
+#endif
 
 #include "brk.h"
 #include <unistd.h>
@@ -49,206 +186,3865 @@
 #include <errno.h> 
 #include <sys/mman.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdarg.h>
+#include "malloc.h"
+#ifdef THREADS
+#include <pthread.h>
+#include <limits.h>
+#endif
+#ifdef TRACE
+#include "trace.h"
+#endif
 
 #define NALLOC 1024                                    /* minimum #units to request */
+#ifndef STRATEGY
+#define STRATEGY 1                                      /* First Fit */
+#endif
+#if STRATEGY == 4 && !defined(BOUNDARY_TAGS)
+#define BOUNDARY_TAGS                                   /* the bins cannot join free neighbours without them */
+#endif
+#if STRATEGY == 0
+static int strategy = 0;                                /* from MALLOC_STRATEGY, see pickStrategy */
+#define STRATEGY_IS(n) (strategy == (n))
+#else
+#define STRATEGY_IS(n) (STRATEGY == (n))                /* folded by the compiler */
+#endif
+#ifndef MMAP_THRESHOLD
+#define MMAP_THRESHOLD (128*1024)                       /* bytes, 0 keeps big blocks on the heap */
+#endif
+#ifndef TRIM_THRESHOLD
+#define TRIM_THRESHOLD (128*1024)                       /* bytes, 0 never gives memory back */
+#endif
+#ifndef DEFER_FREE
+#define DEFER_FREE 0                                    /* blocks free may hold back, 0 frees at once */
+#endif
+#ifndef STATS
+#define STATS 1                                         /* 0 compiles the counters out */
+#endif
+#ifndef HUGEPAGES
+#define HUGEPAGES 0                                     /* 1 asks for transparent huge pages, 2 for MAP_HUGETLB */
+#endif
+#ifndef CHECKS
+#define CHECKS 0                                        /* a sum of the CHECK_ bits below */
+#endif
+#define CHECK_POINTER 1                                 /* free and realloc take only our pointers */
+#define CHECK_HEADER  2                                 /* keyed headers, catches double frees */
+#define CHECK_POISON  4                                 /* freed areas are overwritten */
+#define POISON 0xdf                                     /* with this byte */
+#if CHECKS & CHECK_HEADER
+#define CHECKBITS 16                                    /* of the size word, see union header */
+#else
+#define CHECKBITS 0
+#endif
+#ifndef SLAB_MAX
+#define SLAB_MAX 256                                    /* bytes, malloc takes smaller requests from slabs */
+#endif
+#define NCLASSES (SLAB_MAX/sizeof(Header))              /* one slab pool per multiple of a unit */
+#ifdef BOUNDARY_TAGS
+#define MINUNITS 2                                      /* a free block needs a back link and a footer */
+#else
+#define MINUNITS 1
+#endif
+#define HDR (sizeof(size_t))                            /* bytes of a block in use that are not payload */
+#define NUNITS(nbytes) ((nbytes) + HDR <= MINUNITS*sizeof(Header) ? MINUNITS \
+                        : ((nbytes) + HDR + sizeof(Header)-1)/sizeof(Header))
+#define TOO_BIG(nbytes) ((nbytes) > ((size_t) -1 >> (1 + CHECKBITS)))  /* more than s.size can hold */
+#define PAGE_DOWN(a) ((char *)((unsigned long)(a) & ~((unsigned long)getpagesize()-1)))
+#define PAGE_UP(a)   PAGE_DOWN((char *)(a) + getpagesize()-1)
+#if HUGEPAGES
+#define HUGE_PAGE (2*1024*1024)                         /* the default on x86-64 */
+#define TRIM_PAGE HUGE_PAGE                             /* trimming never splits a huge page */
+#else
+#define TRIM_PAGE getpagesize()
+#endif
+#define TRIM_DOWN(a) ((char *)((unsigned long)(a) & ~((unsigned long)TRIM_PAGE-1)))
+#define TRIM_UP(a)   TRIM_DOWN((char *)(a) + TRIM_PAGE-1)
 
 typedef long Align;                                     /* for alignment to long boundary */
 
+/* A block is a whole number of units and starts HDR bytes before a
+ * 16 byte boundary, so that only the size word is overhead and the
+ * payload, starting at s.ptr, is aligned like malloc's. The link is
+ * only there while the block is free. With CHECK_HEADER the size
+ * gives up CHECKBITS to a check of the block in use, see SEAL.
+ */
 union header {                                          /* block header */
   struct {
-    union header *ptr;                                  /* next block if on free list */
-    unsigned size;                                      /* size of this block  - what unit? */ 
+    size_t size : 8*sizeof(size_t) - 4 - CHECKBITS;     /* in units, the header included */
+#if CHECKBITS > 0
+    size_t check : CHECKBITS;
+#endif
+    size_t flags : 4;                                   /* BT_FREE, BT_PREVFREE, MMAPPED */
+    union header *ptr;                                  /* next block if on free list, else payload */
   } s;
   Align x;                                              /* force alignment of blocks */
 };
 
 typedef union header Header;
 
+#define PAYLOAD(bp) ((void *) &(bp)->s.ptr)             /* the area malloc hands out */
+#define BLOCK(ap)   ((Header *)((char *)(ap) - HDR))    /* and back to its header */
+#define MMAPPED 4                                       /* flag of a block with its own mapping */
+
+/* A new header is written with both fields at once, which the compiler
+ * turns into a single store. Setting the size alone would read the
+ * word first, and a read of a fresh page costs a fault of its own.
+ */
+#if CHECKBITS > 0
+#define NEWBLOCK(p, n, f) ((p)->s.size = (n), (p)->s.check = 0, (p)->s.flags = (f))
+#else
+#define NEWBLOCK(p, n, f) ((p)->s.size = (n), (p)->s.flags = (f))
+#endif
+
+/* A block in use is sealed with a hash of its address, size and
+ * MMAPPED flag, keyed with the address of base so it differs from run
+ * to run under address space randomization, and unsealed (the hash
+ * inverted) when it is freed. free then tells a corrupt header or a
+ * pointer malloc never handed out from a double free. Flags set by
+ * the neighbours of a block are left out.
+ */
+#if CHECKBITS > 0
+#define SEAL_OF(p) ((((unsigned long)(p) ^ (unsigned long) &base ^ (unsigned long)(p)->s.size << 20 \
+                      ^ ((p)->s.flags & MMAPPED)) * 0x9e3779b97f4a7c15UL) >> (8*sizeof(long) - CHECKBITS))
+#define SEAL(p)    ((p)->s.check = SEAL_OF(p))
+#define UNSEAL(p)  ((p)->s.check = ~SEAL_OF(p))
+#else
+#define SEAL(p)    ((void) 0)
+#define UNSEAL(p)  ((void) 0)
+#endif
+
 static Header base;                                     /* empty list to get started */
 static Header *freep = NULL;                            /* start of free list */
 
-/* free
- *
- * free returns nothing, it simply frees memory allocated by malloc.
+#ifdef THREADS
+static pthread_mutex_t arenaLock = PTHREAD_MUTEX_INITIALIZER;
+
+static void lockArena(void)   { pthread_mutex_lock(&arenaLock); }
+static void unlockArena(void) { pthread_mutex_unlock(&arenaLock); }
+#endif
+
+#if STATS
+#define NSIZES 24                                       /* request size classes, see sizeClass */
+
+struct threadStats {                                    /* counted without the arena lock */
+  unsigned long mallocs, frees;
+  unsigned long cacheHits;                              /* mallocs served by the thread cache */
+  unsigned long maps, unmaps;                           /* blocks with a mapping of their own */
+  size_t mappedBytes;                                   /* these may wrap in one thread, */
+  size_t cachedBlocks, cachedBytes;                     /* their sum over all threads is right */
+  unsigned long sizes[NSIZES];                          /* requests of at most 16 << i bytes */
+#ifdef THREADS
+  struct threadStats *next;                             /* on statsList while the thread runs */
+#endif
+};
+
+static struct {                                         /* counted under the arena lock */
+  unsigned long morecores;
+  unsigned long searches, examined;                     /* free list searches and blocks looked at */
+  unsigned long coalesces;                              /* joins with a free neighbour */
+  unsigned long quickHits, consolidations;              /* see Deferred free */
+  size_t heapBytes;                                     /* committed to the heap */
+  size_t slabBytes;                                     /* slab pages handed out */
+} arenaStats;
+
+#ifdef THREADS
+static __thread struct threadStats stats
+  __attribute__((tls_model("initial-exec")));
+static struct threadStats *statsList = NULL;            /* every thread that has counted something */
+static struct threadStats retiredStats;                 /* from threads that have exited */
+#else
+static struct threadStats stats;
+#endif
+
+#define COUNT(c, n)       (stats.c += (n))
+#define ARENA_COUNT(c, n) (arenaStats.c += (n))
+#else
+#define COUNT(c, n)       ((void) 0)
+#define ARENA_COUNT(c, n) ((void) 0)
+#endif
+
+#ifdef TRACE
+#define TRACE_BATCH 128                                 /* records buffered per thread */
+
+struct traceBuffer {
+  struct traceRecord r[TRACE_BATCH];
+  unsigned n;
+};
+
+#ifdef THREADS
+static __thread struct traceBuffer traceBuf
+  __attribute__((tls_model("initial-exec")));
+#else
+static struct traceBuffer traceBuf;
+#endif
+static int traceFd = -1;                                /* not tracing */
+static pid_t tracePid;                                  /* a forked child does not write */
+static unsigned long traceNext = 0;                     /* next sequence number */
+
+/* traceOpen
  *
- * @param    void * ap
+ * traceOpen returns nothing, it starts tracing to the file named by
+ * the environment variable MALLOC_TRACE with the pid added, if there
+ * is one, so that programs it starts under LD_PRELOAD get traces of
+ * their own. Calls made before it runs are not in the trace.
  */
-void free(void * ap)
+__attribute__((constructor))
+static void traceOpen(void)
 {
-  Header *bp, *p;
+  char *env = getenv("MALLOC_TRACE");
+  char name[4096];
 
-  if(ap == NULL) return;                                /* Nothing to do */
-
-  bp = (Header *) ap - 1;                               /* point to block header */
-  for(p = freep; !(bp > p && bp < p->s.ptr); p = p->s.ptr)
-    if(p >= p->s.ptr && (bp > p || bp < p->s.ptr))
-      break;                                            /* freed block at atrt or end of arena */
-  
-  if(bp + bp->s.size == p->s.ptr) {                     /* join to upper nb */
-    bp->s.size += p->s.ptr->s.size;
-    bp->s.ptr = p->s.ptr->s.ptr;
-  }
-  else
-    bp->s.ptr = p->s.ptr;
-  if(p + p->s.size == bp) {                             /* join to lower nbr */
-    p->s.size += bp->s.size;
-    p->s.ptr = bp->s.ptr;
-  } else
-    p->s.ptr = bp;
-  freep = p;
+  if(env == NULL || *env == '\0')
+    return;
+  tracePid = getpid();
+  snprintf(name, sizeof(name), "%s.%d", env, (int) tracePid);
+  if((traceFd = open(name, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644)) < 0)
+    perror(name);
 }
 
-/* morecore: ask system for more memory */
+/* traceFlush
+ *
+ * traceFlush returns nothing, it appends the records buffered by the
+ * calling thread to the trace file in a single write.
+ */
+static void traceFlush(void)
+{
+  if(traceBuf.n > 0 && traceFd >= 0 && getpid() == tracePid)
+    if(write(traceFd, traceBuf.r, traceBuf.n*sizeof(struct traceRecord)) < 0)
+      traceFd = -1;                                     /* give up, but keep running */
+  traceBuf.n = 0;
+}
 
-#ifdef MMAP
+__attribute__((destructor))
+static void traceClose(void) { traceFlush(); }
 
-static void * __endHeap = 0;
+/* traceSeq
+ *
+ * traceSeq returns the sequence number of a call about to be made.
+ * free and realloc take theirs before the block is let go of, and
+ * malloc after it has got one, so a block passed between threads is
+ * nearly always freed before it is handed out again in the trace.
+ */
+static unsigned long traceSeq(void)
+{
+  if(traceFd < 0)
+    return 0;
+#ifdef THREADS
+  return __atomic_fetch_add(&traceNext, 1, __ATOMIC_RELAXED);
+#else
+  return traceNext++;
+#endif
+}
 
-void * endHeap(void)
+/* traceCall
+ *
+ * traceCall returns nothing, it buffers the record of a call, which
+ * is written once TRACE_BATCH of them have been made by the thread.
+ *
+ * @param    unsigned long seq
+ * @param    unsigned op
+ * @param    size_t nbytes
+ * @param    void * ptr
+ * @param    void * result
+ */
+static void traceCall(unsigned long seq, unsigned op, size_t nbytes, void *ptr, void *result)
 {
-  if(__endHeap == 0) __endHeap = sbrk(0);
-  return __endHeap;
+  struct traceRecord *r;
+
+  if(traceFd < 0)
+    return;
+  r = &traceBuf.r[traceBuf.n++];
+  r->seq = seq;
+  r->size = (unsigned long) op << 56 | (nbytes & ((1UL << 56) - 1));
+  r->ptr = (unsigned long) ptr;
+  r->result = (unsigned long) result;
+  if(traceBuf.n == TRACE_BATCH)
+    traceFlush();
 }
 #endif
 
+#ifdef BOUNDARY_TAGS
+#define USE_BINS                                        /* free blocks are kept in bins, not at base */
+#endif
 
-static Header *morecore(unsigned nu)
-{
-  void *cp;
-  Header *up;
-#ifdef MMAP
-  unsigned noPages;
-  if(__endHeap == 0) __endHeap = sbrk(0);
+#ifdef BOUNDARY_TAGS
+#define BT_FREE     1                                   /* this block is on a free list */
+#define BT_PREVFREE 2                                   /* the block below is free, its footer is valid */
+#define PREVLINK(p) (((p)+1)->s.ptr)                    /* back link, first payload unit of a free block */
+#define FOOTER(p)   (((p)+(p)->s.size-1)->s.size)       /* size copy, last payload unit of a free block */
+
+static Header *fencep = NULL;                           /* in-use sentinel ending the last region */
 #endif
 
-  if(nu < NALLOC)
-    nu = NALLOC;
-#ifdef MMAP
-  noPages = ((nu*sizeof(Header))-1)/getpagesize() + 1;
-  cp = mmap(__endHeap, noPages*getpagesize(), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
-  nu = (noPages*getpagesize())/sizeof(Header);
-  __endHeap += noPages*getpagesize();
+#ifdef USE_BINS
+#if defined(STRATEGY) && STRATEGY == 4
+#define NSMALLBINS 64                                   /* exact bins for 0..NSMALLBINS-1 units */
+#define LOG2_NSMALLBINS 6
+#define NBINS (NSMALLBINS + 8*sizeof(size_t) - LOG2_NSMALLBINS)
 #else
-  cp = sbrk(nu*sizeof(Header));
+#define NBINS 1                                         /* a single unordered list */
 #endif
-  if(cp == (void *) -1){                                 /* no space at all */
-    perror("failed to get more memory");
-    return NULL;
-  }
-  up = (Header *) cp;
-  up->s.size = nu;
-  free((void *)(up+1));
-  return freep;
-}
+#define BITS_PER_WORD (8*sizeof(unsigned long))
+#define NBINWORDS ((NBINS + BITS_PER_WORD - 1)/BITS_PER_WORD)
 
+static Header *bins[NBINS];                             /* one NULL terminated list per size class */
+#ifndef NSMALLBINS
+static Header *rover = NULL;                            /* where Next Fit resumes its search */
+#endif
+static unsigned long binmap[NBINWORDS];                 /* bit i set if bins[i] is non-empty */
 
-/* malloc
+#ifndef TREE_MIN
+#define TREE_MIN 256                                    /* bytes, bigger free blocks are kept in a tree, 0 never */
+#endif
+#if TREE_MIN > 0
+#define TREE_UNITS (TREE_MIN/sizeof(Header) < 3 ? 3 : TREE_MIN/sizeof(Header))
+#define LEFT(p)  ((p)->s.ptr)                           /* links of a block in the tree, */
+#define RIGHT(p) (((p)+1)->s.ptr)                       /* in place of the bin links */
+#define BEFORE(p, q) ((p)->s.size < (q)->s.size || ((p)->s.size == (q)->s.size && (p) < (q)))
+#define PRIORITY(p) (((unsigned long)(p) >> 4) * 0x9e3779b97f4a7c15UL)
+
+static Header *tree = NULL;                             /* free blocks by size, then address */
+#endif
+
+/* binIndex
  *
- * malloc returns a pointer to the allocated area. 
- * If STRATEGY is defined the execution path may vary
- * depending on the value of the variable.
+ * binIndex returns the bin a block of nu units belongs to. Below
+ * NSMALLBINS every unit count has a bin of its own, above that
+ * each bin covers the range [2^k, 2^(k+1)).
  *
- * @param    size_t nbytes
+ * @param    size_t nu
  */
-void * malloc(size_t nbytes)
+static unsigned binIndex(size_t nu)
 {
+#ifndef NSMALLBINS
+  return 0;
+#else
+  unsigned log2 = 0;
 
-  Header *p, *prevp;
-  Header * morecore(unsigned);
-  unsigned nunits;
+  if(nu < NSMALLBINS) return nu;
+  while(nu >>= 1)
+    log2++;
+  return NSMALLBINS + log2 - LOG2_NSMALLBINS;
+#endif
+}
 
-  if(nbytes <= 0) return NULL;
+#if TREE_MIN > 0
+/* Size tree
+ *
+ * Free blocks of TREE_MIN bytes or more are kept in a treap ordered
+ * by size and then by address, linked through the blocks themselves.
+ * The priority of a block is a hash of its address, so the tree is
+ * balanced in expectation without storing anything more. Searches
+ * for the smallest block that fits, or the biggest, take O(log n).
+ */
 
-  nunits = (nbytes+sizeof(Header)-1)/sizeof(Header) +1;
+/* treeInsert
+ *
+ * treeInsert returns the root of the tree t with the free block bp
+ * added to it.
+ *
+ * @param    Header * t
+ * @param    Header * bp
+ */
+static Header *treeInsert(Header *t, Header *bp)
+{
+  Header *c;
 
-  if((prevp = freep) == NULL) {
-    base.s.ptr = freep = prevp = &base;
-    base.s.size = 0;
+  if(t == NULL) {
+    LEFT(bp) = RIGHT(bp) = NULL;
+    return bp;
   }
-
-  /* Worst Fit*/
-#ifdef STRATEGY
-  if(STRATEGY == 3){
-    Header * biggest = base.s.ptr;
-    for(p=biggest->s.ptr;p !=base.s.ptr  ; prevp = p, p = p->s.ptr) {
-      if(p->s.size>biggest->s.size){
-	biggest = p;
-      }
+  if(BEFORE(bp, t)) {
+    c = LEFT(t) = treeInsert(LEFT(t), bp);
+    if(PRIORITY(c) > PRIORITY(t)) {                     /* rotate right */
+      LEFT(t) = RIGHT(c);
+      RIGHT(c) = t;
+      return c;
     }
-    if(biggest->s.size >= nunits) {                           /* big enough */
-      if (biggest->s.size == nunits)                          /* exactly */
-	prevp->s.ptr = biggest->s.ptr;
-      else {                                            /* allocate tail end */
-	biggest->s.size -= nunits;
-	biggest += biggest->s.size;
-	biggest->s.size = nunits;
-      }
-      freep = prevp;
-      return (void *)(biggest+1);
+  } else {
+    c = RIGHT(t) = treeInsert(RIGHT(t), bp);
+    if(PRIORITY(c) > PRIORITY(t)) {                     /* rotate left */
+      RIGHT(t) = LEFT(c);
+      LEFT(c) = t;
+      return c;
     }
-    if(biggest->s.size < nunits)                                      /* wrapped around free list */
-      if((biggest = morecore(nunits)) == NULL)
-	return NULL;                                    /* none left */
   }
-#endif
+  return t;
+}
 
-  /*First Fit - Default*/
-  prevp = &base;
-  for(p=prevp->s.ptr;  ; prevp = p, p = p->s.ptr) {
-    if(p->s.size >= nunits) {                           /* big enough */
-      if (p->s.size == nunits)                          /* exactly */
-	prevp->s.ptr = p->s.ptr;
-      else {                                            /* allocate tail end */
-	p->s.size -= nunits;
-	p += p->s.size;
-	p->s.size = nunits;
-      }
-      freep = prevp;
-      return (void *)(p+1);
+/* treeJoin
+ *
+ * treeJoin returns the root of a tree holding the trees a and b,
+ * where every block of a comes before every block of b.
+ *
+ * @param    Header * a
+ * @param    Header * b
+ */
+static Header *treeJoin(Header *a, Header *b)
+{
+  if(a == NULL) return b;
+  if(b == NULL) return a;
+  if(PRIORITY(a) > PRIORITY(b)) {
+    RIGHT(a) = treeJoin(RIGHT(a), b);
+    return a;
+  }
+  LEFT(b) = treeJoin(a, LEFT(b));
+  return b;
+}
+
+/* treeRemove
+ *
+ * treeRemove returns the root of the tree t with the block bp, which
+ * must be in it, taken out. It is found by its size and address.
+ *
+ * @param    Header * t
+ * @param    Header * bp
+ */
+static Header *treeRemove(Header *t, Header *bp)
+{
+  if(t == bp)
+    return treeJoin(LEFT(t), RIGHT(t));
+  if(BEFORE(bp, t))
+    LEFT(t) = treeRemove(LEFT(t), bp);
+  else
+    RIGHT(t) = treeRemove(RIGHT(t), bp);
+  return t;
+}
+
+/* treeFit
+ *
+ * treeFit returns the smallest block in the tree of at least nunits
+ * units, the lowest of those of the same size, or NULL.
+ *
+ * @param    size_t nunits
+ */
+static Header *treeFit(size_t nunits)
+{
+  Header *t, *fit = NULL;
+
+  for(t = tree; t != NULL; ) {
+    ARENA_COUNT(examined, 1);
+    if(t->s.size >= nunits) {
+      fit = t;
+      t = LEFT(t);
     }
-    if(p == freep)                                      /* wrapped around free list */
-      if((p = morecore(nunits)) == NULL)
-	return NULL;                                    /* none left */
+    else
+      t = RIGHT(t);
   }
+  return fit;
 }
 
-/* realloc
+/* treeNext
  *
- * realloc returns a pointer to the reallocated area.
- * It relies on malloc and free defined above to execute.
+ * treeNext returns the block after p in the tree, the first one if
+ * p is NULL, or NULL after the last. Walking the tree this way does
+ * not need a stack.
  *
- * @param    void *ptr
- * @param    size_t size
+ * @param    Header * p
  */
-void * realloc(void *ptr, size_t size){
+static Header *treeNext(Header *p)
+{
+  Header *t, *next = NULL;
 
-  if(ptr == NULL && size > 0){
-    ptr = malloc(size);
-    return ptr;
+  for(t = tree; t != NULL; )
+    if(p == NULL || BEFORE(p, t)) {
+      next = t;
+      t = LEFT(t);
+    }
+    else
+      t = RIGHT(t);
+  return next;
+}
+#endif
+
+/* binInsert
+ *
+ * binInsert returns nothing, it pushes the free block bp on the
+ * front of its bin.
+ *
+ * @param    Header * bp
+ */
+static void binInsert(Header *bp)
+{
+  unsigned i = binIndex(bp->s.size);
+
+#if TREE_MIN > 0
+  if(bp->s.size >= TREE_UNITS) {
+    tree = treeInsert(tree, bp);
+    return;
   }
+#endif
 
-  if(ptr != NULL && size == 0){
-    free(ptr);
-    return NULL;
+  bp->s.ptr = bins[i];
+#ifdef BOUNDARY_TAGS
+  PREVLINK(bp) = NULL;
+  if(bins[i] != NULL)
+    PREVLINK(bins[i]) = bp;
+#endif
+  bins[i] = bp;
+  binmap[i/BITS_PER_WORD] |= 1UL << (i%BITS_PER_WORD);
+}
+
+/* binUnlink
+ *
+ * binUnlink returns nothing, it removes p from bin i given the
+ * block in front of it, or NULL if p is first in the bin. With
+ * BOUNDARY_TAGS the lists are doubly linked and prevp is ignored.
+ * A block big enough for the tree is taken out of the tree instead.
+ *
+ * @param    unsigned i
+ * @param    Header * prevp
+ * @param    Header * p
+ */
+static void binUnlink(unsigned i, Header *prevp, Header *p)
+{
+#if TREE_MIN > 0
+  if(p->s.size >= TREE_UNITS) {
+    tree = treeRemove(tree, p);
+    return;
   }
+#endif
+#ifdef BOUNDARY_TAGS
+  prevp = PREVLINK(p);
+  if(p->s.ptr != NULL)
+    PREVLINK(p->s.ptr) = prevp;
+#endif
+  if(prevp == NULL)
+    bins[i] = p->s.ptr;
+  else
+    prevp->s.ptr = p->s.ptr;
+#ifndef NSMALLBINS
+  if(p == rover)
+    rover = p->s.ptr;
+#endif
+  if(bins[i] == NULL)
+    binmap[i/BITS_PER_WORD] &= ~(1UL << (i%BITS_PER_WORD));
+}
 
-  if(ptr == NULL && size <= 0){
-    return NULL;
+#ifdef NSMALLBINS
+/* binNonEmpty
+ *
+ * binNonEmpty returns the first non-empty bin at index i or above,
+ * or NBINS if there is none. It only looks at the bitmap.
+ *
+ * @param    unsigned i
+ */
+static unsigned binNonEmpty(unsigned i)
+{
+  unsigned w = i/BITS_PER_WORD;
+  unsigned long bits;
+
+  if(i >= NBINS) return NBINS;
+  bits = binmap[w] & (~0UL << (i%BITS_PER_WORD));
+  while(bits == 0){
+    if(++w == NBINWORDS) return NBINS;
+    bits = binmap[w];
   }
+  return w*BITS_PER_WORD + __builtin_ctzl(bits);
+}
+#endif
 
-  Header * headerPointer =  (Header *)ptr-1; /* För att få tillgång till header. */
-  size_t old_size = (headerPointer->s.size-1)*sizeof(Header);
-  Header * newAreaPointer = malloc(size); /* Malloc tar size i bytes */
-  Header * result;
-  
-  if(old_size <= size){
-    result = memcpy(newAreaPointer,ptr,old_size);
+/* binSplit
+ *
+ * binSplit returns a block of nunits units carved from the free
+ * block p, which has already been unlinked from its bin. If the
+ * remainder is big enough it stays free and goes back in a bin.
+ *
+ * @param    Header * p
+ * @param    size_t nunits
+ */
+static Header *binSplit(Header *p, size_t nunits)
+{
+  if(p->s.size - nunits >= 2) {                         /* allocate tail end, keep the rest */
+    p->s.size -= nunits;
+#ifdef BOUNDARY_TAGS
+    FOOTER(p) = p->s.size;
+#endif
+    binInsert(p);
+    p += p->s.size;
+#ifdef BOUNDARY_TAGS
+    NEWBLOCK(p, nunits, BT_PREVFREE);
+#else
+    NEWBLOCK(p, nunits, 0);
+#endif
   }
-  if(old_size > size){
-    result = memcpy(newAreaPointer,ptr,size);
+#ifdef BOUNDARY_TAGS
+  else
+    p->s.flags &= ~BT_FREE;
+  (p + p->s.size)->s.flags &= ~BT_PREVFREE;             /* upper neighbour now sees us in use */
+#endif
+  return p;
+}
+
+#if TREE_MIN > 0
+/* treeTake
+ *
+ * treeTake returns a block of exactly nunits units cut from the
+ * smallest block in the tree that fits, or for Worst Fit from the
+ * biggest, or NULL if none is big enough.
+ *
+ * @param    size_t nunits
+ */
+static Header *treeTake(size_t nunits)
+{
+  Header *p;
+
+  if(STRATEGY_IS(3))
+    for(p = tree; p != NULL && RIGHT(p) != NULL; p = RIGHT(p))
+      ARENA_COUNT(examined, 1);
+  else
+    p = treeFit(nunits);
+  if(p == NULL || p->s.size < nunits)
+    return NULL;
+  tree = treeRemove(tree, p);
+  return binSplit(p, nunits);
+}
+#else
+#define treeTake(nunits) NULL
+#endif
+
+/* binTake
+ *
+ * binTake returns a block of exactly nunits units taken from the
+ * bins, or NULL if no bin holds a block that is big enough. For
+ * STRATEGY 4 the bin of the request is searched first, after that
+ * every block in a higher bin fits. Otherwise the single bin is
+ * searched by First, Best, Worst or Next Fit. The blocks in the
+ * size tree are bigger than any in a bin, so requests for that much
+ * go straight to the tree and the rest only when the bins fail, but
+ * for Worst Fit, which wants the biggest block there is.
+ *
+ * @param    size_t nunits
+ */
+static Header *binTake(size_t nunits)
+{
+  Header *p, *prevp = NULL;
+  unsigned i = binIndex(nunits);
+
+#if TREE_MIN > 0
+  if(nunits >= TREE_UNITS || (STRATEGY_IS(3) && tree != NULL))
+    return treeTake(nunits);
+#endif
+
+#if defined(STRATEGY) && STRATEGY == 4
+  if(i >= NSMALLBINS) {                                 /* ranged bin, search it first */
+    for(p = bins[i]; p != NULL; prevp = p, p = p->s.ptr) {
+      ARENA_COUNT(examined, 1);
+      if(p->s.size >= nunits)
+        break;
+    }
   }
+  else
+    p = bins[i];                                        /* exact bin, any block fits */
 
-  free(ptr);
+  if(p == NULL) {                                       /* every block in a higher bin fits */
+    prevp = NULL;
+    if((i = binNonEmpty(i+1)) == NBINS)
+      return treeTake(nunits);
+    p = bins[i];
+  }
+#else
+  Header *q, *prevq = NULL;
 
-  return newAreaPointer;
+  p = NULL;
+  if(STRATEGY_IS(5)) {                                  /* Next Fit */
+    for(p = rover; p != NULL && p->s.size < nunits; p = p->s.ptr)
+      ARENA_COUNT(examined, 1);                         /* from the rover to the end */
+    if(p == NULL) {
+      for(p = bins[i]; p != rover && p->s.size < nunits; p = p->s.ptr)
+        ARENA_COUNT(examined, 1);                       /* then from the start up to the rover */
+      if(p == rover)
+        return treeTake(nunits);
+    }
+    rover = p->s.ptr;
+  }
+  else
+    for(q = bins[i]; q != NULL; prevq = q, q = q->s.ptr) {
+      ARENA_COUNT(examined, 1);
+      if(q->s.size < nunits)
+        continue;
+      if(STRATEGY_IS(2) ? p == NULL || q->s.size < p->s.size    /* Best Fit */
+         : STRATEGY_IS(3) ? p == NULL || q->s.size > p->s.size  /* Worst Fit */
+         : 1) {                                                 /* First Fit */
+        prevp = prevq;
+        p = q;
+        if(STRATEGY_IS(1) || (STRATEGY_IS(2) && p->s.size == nunits))
+          break;
+      }
+    }
+  if(p == NULL)
+    return treeTake(nunits);
+#endif
+  binUnlink(i, prevp, p);
+  return binSplit(p, nunits);
 }
+#endif
+
+#ifndef USE_BINS
+/* listInsert
+ *
+ * listInsert returns the free block bp ended up in, after it was put
+ * in its place on the address ordered free list, searching from p on,
+ * and joined with its free neighbours.
+ *
+ * @param    Header * p
+ * @param    Header * bp
+ */
+static Header *listInsert(Header *p, Header *bp)
+{
+  for(; !(bp > p && bp < p->s.ptr); p = p->s.ptr)
+    if(p >= p->s.ptr && (bp > p || bp < p->s.ptr))
+      break;                                            /* freed block at atrt or end of arena */
+  
+  if(bp + bp->s.size == p->s.ptr) {                     /* join to upper nb */
+    bp->s.size += p->s.ptr->s.size;
+    bp->s.ptr = p->s.ptr->s.ptr;
+    ARENA_COUNT(coalesces, 1);
+  }
+  else
+    bp->s.ptr = p->s.ptr;
+  freep = p;
+  if(p + p->s.size == bp) {                             /* join to lower nbr */
+    p->s.size += bp->s.size;
+    p->s.ptr = bp->s.ptr;
+    ARENA_COUNT(coalesces, 1);
+    return p;
+  }
+  p->s.ptr = bp;
+  return bp;
+}
+#endif
+
+/* freeBlock
+ *
+ * freeBlock returns the free block bp ended up in, after it was put
+ * back on the free list and joined with its free neighbours. It is also how
+ * morecore hands over new memory, calling it rather than free keeps
+ * the compiler from treating the stores in front of it as dead.
+ *
+ * @param    Header * bp
+ */
+static Header *freeBlock(Header *bp)
+{
+#ifdef BOUNDARY_TAGS
+  Header *p;
+#endif
+
+#ifdef BOUNDARY_TAGS
+  p = bp + bp->s.size;
+  if(p->s.flags & BT_FREE) {                            /* join to upper nbr */
+    binUnlink(binIndex(p->s.size), NULL, p);
+    bp->s.size += p->s.size;
+    ARENA_COUNT(coalesces, 1);
+  }
+  if(bp->s.flags & BT_PREVFREE) {                       /* join to lower nbr, found by its footer */
+    p = bp - (bp-1)->s.size;
+    binUnlink(binIndex(p->s.size), NULL, p);
+    p->s.size += bp->s.size;
+    bp = p;
+    ARENA_COUNT(coalesces, 1);
+  }
+  bp->s.flags = BT_FREE;                                /* the block below is in use now */
+  FOOTER(bp) = bp->s.size;
+  (bp + bp->s.size)->s.flags |= BT_PREVFREE;
+#endif
+#ifdef USE_BINS
+  binInsert(bp);                                        /* no list walk, just push on its bin */
+  return bp;
+#else
+  return listInsert(freep, bp);
+#endif
+}
+
+/* morecore: ask system for more memory */
+
+static char *coreEnd = NULL;                            /* end of the last region morecore got */
+#define CORE_TOP ((Header *)(coreEnd - HDR))            /* where a block ending that region ends */
+#if CHECKS & CHECK_POINTER
+static char *coreLow = NULL, *coreHigh = NULL;          /* every region morecore got lies in between */
+#endif
+
+#if STATS
+struct region {                                         /* memory morecore got in one piece */
+  char *start, *end;
+};
+
+static struct region *regions = NULL;                   /* in the order morecore got them */
+static size_t nregions = 0, maxRegions = 0;
+static volatile sig_atomic_t heapMapWanted = 0;         /* set by the signal, see heapMapOpen */
+static void heapMapDump(void);
+
+/* noteRegion
+ *
+ * noteRegion returns nothing, it records that the region holding
+ * start, or the new one starting there, now ends at end, for the heap
+ * walks. The table lives in a mapping of its own and doubles when
+ * full. With THREADS the arena lock must be held.
+ *
+ * @param    char * start
+ * @param    char * end
+ */
+static void noteRegion(char *start, char *end)
+{
+  struct region *more;
+  size_t size;
+
+  if(nregions > 0 && start >= regions[nregions-1].start && start <= regions[nregions-1].end) {
+    regions[nregions-1].end = end;
+    return;
+  }
+  if(nregions == maxRegions) {
+    size = maxRegions ? 2*maxRegions*sizeof(struct region) : (size_t) getpagesize();
+    more = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(more == MAP_FAILED)
+      return;                                           /* the walks will miss it */
+    if(regions != NULL) {
+      memcpy(more, regions, nregions*sizeof(struct region));
+      munmap(regions, maxRegions*sizeof(struct region));
+    }
+    regions = more;
+    maxRegions = size/sizeof(struct region);
+  }
+  regions[nregions].start = start;
+  regions[nregions++].end = end;
+}
+#endif
+
+#ifdef MMAP
+
+#ifndef MMAP_RESERVE
+#define MMAP_RESERVE (64*1024*1024)                     /* bytes, 0 maps every chunk on its own */
+#endif
+
+static void * __endHeap = 0;                            /* end of the committed heap */
+
+void * endHeap(void)
+{
+  if(__endHeap == 0) __endHeap = sbrk(0);
+  return __endHeap;
+}
+
+#if HUGEPAGES && MMAP_RESERVE == 0
+#error "HUGEPAGES commits huge pages from the reserve, MMAP_RESERVE must not be 0"
+#endif
+
+#if MMAP_RESERVE > 0
+static char *reserveEnd = 0;                            /* end of the reserved address space */
+static size_t commitSize = 0;                           /* bytes committed by the last call */
+
+#if HUGEPAGES
+/* reserveHuge
+ *
+ * reserveHuge returns size bytes of address space without access
+ * rights starting at a HUGE_PAGE boundary, at hint if the kernel
+ * agrees, or MAP_FAILED. With HUGEPAGES 2 the space is taken from
+ * the MAP_HUGETLB pool. When the pool cannot hold it, and for good
+ * after that, or with HUGEPAGES 1, ordinary pages are reserved and
+ * madvise asks for transparent huge pages, which the kernel may or
+ * may not give.
+ *
+ * @param    char * hint
+ * @param    size_t size
+ */
+static void * reserveHuge(char *hint, size_t size)
+{
+  static int hugetlb = HUGEPAGES == 2;
+  char *p;
+  size_t slop;
+
+#ifdef MAP_HUGETLB
+  if(hugetlb) {
+    p = mmap(hint, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if(p != MAP_FAILED)
+      return p;                                         /* always aligned to the huge page size */
+    hugetlb = 0;
+  }
+#endif
+  p = mmap(hint, size + HUGE_PAGE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if(p == MAP_FAILED)
+    return MAP_FAILED;
+  slop = TRIM_UP(p) - p;                                /* 0 if the hint was honoured */
+  if(slop > 0)
+    munmap(p, slop);
+  munmap(p + slop + size, HUGE_PAGE - slop);
+  p += slop;
+  madvise(p, size, MADV_HUGEPAGE);
+  return p;
+}
+#endif
+
+/* commitCore
+ *
+ * commitCore returns the start of at least *len bytes of newly
+ * committed memory right at __endHeap, and sets *len to the amount
+ * actually committed, or returns MAP_FAILED. Address space is
+ * reserved MMAP_RESERVE bytes at a time without access rights and
+ * committed with mprotect in chunks that double on every call. A new
+ * reservation is asked for right after the old one, and only counts
+ * as contiguous if the kernel honoured that hint. With HUGEPAGES the
+ * reservations and chunks are whole huge pages, see reserveHuge.
+ *
+ * @param    size_t * len
+ */
+static void * commitCore(size_t *len)
+{
+  size_t want = 2*commitSize, size;
+  char *p;
+
+  if(want > MMAP_RESERVE/4)
+    want = MMAP_RESERVE/4;
+  if(want < *len)
+    want = *len;
+#if HUGEPAGES
+  want = (size_t) TRIM_UP(want);
+#endif
+  if(reserveEnd == 0 || (char *) __endHeap + *len > reserveEnd) {
+    size = want > MMAP_RESERVE ? want : MMAP_RESERVE;
+#if HUGEPAGES
+    size = (size_t) TRIM_UP(size);
+    p = reserveHuge(reserveEnd ? reserveEnd : TRIM_UP(__endHeap), size);
+#else
+    p = mmap(reserveEnd ? reserveEnd : __endHeap, size, PROT_NONE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+#endif
+    if(p == MAP_FAILED)
+      return MAP_FAILED;
+    if(p != reserveEnd) {                               /* hint not honoured, a region of its own */
+      if(reserveEnd != 0)
+        munmap(__endHeap, reserveEnd - (char *) __endHeap);
+      __endHeap = p;
+    }
+    reserveEnd = p + size;
+  }
+  if(want > (size_t)(reserveEnd - (char *) __endHeap))
+    want = reserveEnd - (char *) __endHeap;
+  if(mprotect(__endHeap, want, PROT_READ | PROT_WRITE) != 0)
+    return MAP_FAILED;
+  p = __endHeap;
+  __endHeap = p + want;
+  commitSize = want;
+  *len = want;
+  return p;
+}
+#endif
+#endif
+
+
+static Header *morecore(size_t nu)
+{
+  char *cp;
+  Header *up;
+  size_t len;
+#ifdef MMAP
+  if(__endHeap == 0) __endHeap = sbrk(0);
+#endif
+
+  if(nu < NALLOC)
+    nu = NALLOC;
+#ifdef BOUNDARY_TAGS
+  nu++;                                                 /* room for the fence */
+#endif
+  if(nu > ((size_t) -1 >> 1)/sizeof(Header) - 2)        /* sbrk would take it as negative */
+    return NULL;
+  len = (nu + 1)*sizeof(Header);                        /* a unit more for the offset, see HDR */
+#ifdef MMAP
+  len = (size_t) PAGE_UP(len);
+#if MMAP_RESERVE > 0
+  cp = commitCore(&len);
+#else
+  cp = mmap(__endHeap, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(cp != MAP_FAILED)
+    __endHeap = (char *) cp + len;                      /* the hint may not have been honoured */
+#endif
+#else
+  cp = sbrk(len);
+#endif
+  if(cp == (void *) -1){                                 /* no space at all */
+    perror("failed to get more memory");
+    return NULL;
+  }
+  ARENA_COUNT(morecores, 1);
+  ARENA_COUNT(heapBytes, len);
+  if(cp == coreEnd)                                     /* continues the last region */
+    up = CORE_TOP;
+  else
+    up = (Header *)(cp + HDR);
+  coreEnd = cp + len;
+#if CHECKS & CHECK_POINTER
+  if(coreLow == NULL || cp < coreLow)
+    coreLow = cp;
+  if(coreEnd > coreHigh)
+    coreHigh = coreEnd;
+#endif
+#if STATS
+  noteRegion(cp, coreEnd);
+#endif
+  nu = CORE_TOP - up;
+#ifdef BOUNDARY_TAGS
+  if(fencep != NULL && fencep + 1 == up) {              /* continues the last region, absorb its fence */
+    up = fencep;
+    NEWBLOCK(up, nu, up->s.flags & BT_PREVFREE);
+  }
+  else
+    NEWBLOCK(up, --nu, 0);                              /* nothing below the first block of a region */
+  fencep = up + nu;
+  NEWBLOCK(fencep, 1, 0);
+#else
+  NEWBLOCK(up, nu, 0);
+#endif
+  freeBlock(up);
+  return freep;
+}
+
+
+#if TRIM_THRESHOLD > 0
+static size_t trimThreshold = 0;                        /* set on first use, see getTrimThreshold */
+
+/* getTrimThreshold
+ *
+ * getTrimThreshold returns the size in bytes a free block must reach
+ * before its pages are given back to the system. It is TRIM_THRESHOLD
+ * unless the environment variable MALLOC_TRIM_THRESHOLD says otherwise.
+ */
+static size_t getTrimThreshold(void)
+{
+  char *env;
+
+  if(trimThreshold == 0) {
+    trimThreshold = TRIM_THRESHOLD;
+    if((env = getenv("MALLOC_TRIM_THRESHOLD")) != NULL && strtoul(env, NULL, 10) > 0)
+      trimThreshold = strtoul(env, NULL, 10);
+  }
+  return trimThreshold;
+}
+
+/* trimTop
+ *
+ * trimTop returns 1 if the free block bp ended the heap and the
+ * whole pages above its first pad bytes could be unmapped (or
+ * handed back with sbrk), 0 otherwise.
+ *
+ * @param    Header * bp
+ * @param    size_t pad
+ */
+static int trimTop(Header *bp, size_t pad)
+{
+  char *end, *keep;
+  int released;
+
+#ifdef BOUNDARY_TAGS
+  if(bp + bp->s.size != fencep)
+    return 0;
+  end = (char *)(fencep + 1) + HDR;
+  keep = TRIM_UP((char *)(bp + 3) + pad);               /* header, back link and the new fence */
+#else
+#ifdef MMAP
+  end = __endHeap;
+#else
+  end = sbrk(0);
+#endif
+  if((char *)(bp + bp->s.size) != end - HDR)
+    return 0;
+  keep = TRIM_UP((char *)(bp + 2) + pad);
+#endif
+  if(keep >= end)
+    return 0;
+#if defined(MMAP) && MMAP_RESERVE > 0
+  if(end == __endHeap)                                  /* decommit, but keep the space reserved */
+#if HUGEPAGES                                           /* a new mapping would lose the huge pages */
+    released = madvise(keep, end - keep, MADV_DONTNEED) == 0
+               && mprotect(keep, end - keep, PROT_NONE) == 0;
+#else
+    released = mmap(keep, end - keep, PROT_NONE, MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                    -1, 0) != MAP_FAILED;
+#endif
+  else
+    released = munmap(keep, end - keep) == 0;
+#elif defined(MMAP)
+  released = munmap(keep, end - keep) == 0;
+#else
+  released = sbrk(0) == end && sbrk(-(end - keep)) != (void *) -1;
+#endif
+  if(!released)
+    return 0;
+  ARENA_COUNT(heapBytes, -(size_t)(end - keep));
+  if(coreEnd == end) {
+    coreEnd = keep;
+#if STATS
+    noteRegion(keep, keep);
+#endif
+  }
+#ifdef MMAP
+  if(__endHeap == end)
+    __endHeap = keep;                                   /* next morecore continues right here */
+#endif
+#ifdef BOUNDARY_TAGS
+  binUnlink(binIndex(bp->s.size), NULL, bp);
+  fencep = (Header *)(keep - HDR) - 1;
+  NEWBLOCK(fencep, 1, BT_PREVFREE);
+  bp->s.size = fencep - bp;
+  FOOTER(bp) = bp->s.size;
+  binInsert(bp);
+#else
+  bp->s.size = (Header *)(keep - HDR) - bp;
+#endif
+  return 1;
+}
+
+/* trimPages
+ *
+ * trimPages returns 1 if whole pages of the free block bp inside
+ * [lo, hi) were released with madvise, 0 otherwise. The pages stay
+ * mapped and read back as zero. The units holding the header, the
+ * back link and the footer are never touched.
+ *
+ * @param    Header * bp
+ * @param    char * lo
+ * @param    char * hi
+ */
+static int trimPages(Header *bp, char *lo, char *hi)
+{
+  if(lo < (char *)(bp + 2))
+    lo = (char *)(bp + 2);
+  if(hi > (char *)(bp + bp->s.size - 1))
+    hi = (char *)(bp + bp->s.size - 1);
+  lo = TRIM_UP(lo);
+  hi = TRIM_DOWN(hi);
+  if(hi <= lo)
+    return 0;
+  return madvise(lo, hi - lo, MADV_DONTNEED) == 0;
+}
+
+/* trimBlock
+ *
+ * trimBlock returns nothing. If the free block bp has reached the
+ * trim threshold, the part of it around [lo, hi) (what was just
+ * freed) is given back to the system, by shrinking the heap if bp
+ * ends it and with madvise otherwise. One page on each side is
+ * included for the headers and footers the join made redundant.
+ * Pages further away were released when they were freed.
+ *
+ * @param    Header * bp
+ * @param    char * lo
+ * @param    char * hi
+ */
+static void trimBlock(Header *bp, char *lo, char *hi)
+{
+  if(bp->s.size*sizeof(Header) < getTrimThreshold())
+    return;
+  trimTop(bp, 0);
+  trimPages(bp, TRIM_DOWN(lo) - TRIM_PAGE, TRIM_UP(hi) + TRIM_PAGE);
+}
+
+static int slabTrim(void);                              /* see Slabs */
+#if DEFER_FREE > 0
+static void consolidate(void);                          /* see Deferred free */
+#endif
+
+/* malloc_trim
+ *
+ * malloc_trim returns 1 if any memory was given back to the system
+ * and 0 otherwise. Every free block and free slab page is released
+ * with madvise whatever its size, and the top of the heap is shrunk
+ * to pad bytes.
+ *
+ * @param    size_t pad
+ */
+int malloc_trim(size_t pad)
+{
+  Header *p;
+  int released = 0;
+#ifdef USE_BINS
+  unsigned i;
+#endif
+
+#ifdef THREADS
+  lockArena();
+#endif
+#if DEFER_FREE > 0
+  consolidate();
+#endif
+#ifdef USE_BINS
+#ifdef BOUNDARY_TAGS
+  if(fencep != NULL && (fencep->s.flags & BT_PREVFREE)) /* only the block below the fence ends the heap */
+    released = trimTop(fencep - (fencep-1)->s.size, pad);
+#endif
+  for(i = 0; i < NBINS; i++)
+    for(p = bins[i]; p != NULL; p = p->s.ptr)
+      released |= trimPages(p, (char *) p, (char *)(p + p->s.size));
+#if TREE_MIN > 0
+  for(p = treeNext(NULL); p != NULL; p = treeNext(p))
+    released |= trimPages(p, (char *) p, (char *)(p + p->s.size));
+#endif
+#else
+  if((p = freep) != NULL)
+    do {
+      released |= trimTop(p, pad);
+      released |= trimPages(p, (char *) p, (char *)(p + p->s.size));
+    } while((p = p->s.ptr) != freep);
+#endif
+  released |= slabTrim();
+#ifdef THREADS
+  unlockArena();
+#endif
+  return released;
+}
+#else
+/* Without trimming nothing is ever given back, but malloc_trim is still
+ * defined so callers do not end up in the libc one. */
+int malloc_trim(size_t pad)
+{
+  return 0;
+}
+#endif
+
+#if STRATEGY == 0
+/* pickStrategy
+ *
+ * pickStrategy returns the strategy named by the environment variable
+ * MALLOC_STRATEGY, either by number or as first, best, worst or next.
+ * Segregated Fit changes how free blocks are kept and can only be
+ * chosen at compile time. Anything else gives First Fit.
+ */
+static int pickStrategy(void)
+{
+  static const char *names[] = { "", "first", "best", "worst", "", "next" };
+  char *env = getenv("MALLOC_STRATEGY");
+  int i;
+
+  if(env == NULL)
+    return 1;
+  for(i = 1; i <= 5; i++)
+    if(i != 4 && (strcmp(env, names[i]) == 0 || (env[0] == '0'+i && env[1] == '\0')))
+      return i;
+  return 1;
+}
+#endif
+
+#ifndef USE_BINS
+/* listTake
+ *
+ * listTake returns a block of nunits units taken from the address
+ * ordered free list, or NULL if no free block is big enough. First
+ * Fit takes the lowest block that fits, Best Fit the smallest, Worst
+ * Fit the biggest, and Next Fit the first one after freep, where the
+ * previous search ended (the original K&R behaviour).
+ *
+ * @param    size_t nunits
+ */
+static Header *listTake(size_t nunits)
+{
+  Header *p, *prevp, *fit = NULL, *prevfit = NULL;
+
+  if(STRATEGY_IS(5)) {                                  /* Next Fit */
+    for(prevp = freep, p = prevp->s.ptr; ; prevp = p, p = p->s.ptr) {
+      ARENA_COUNT(examined, 1);
+      if(p->s.size >= nunits) {
+        fit = p;
+        prevfit = prevp;
+        break;
+      }
+      if(p == freep)                                    /* wrapped around free list */
+        break;
+    }
+  }
+  else                                                  /* First, Best and Worst Fit */
+    for(prevp = &base, p = base.s.ptr; p != &base; prevp = p, p = p->s.ptr) {
+      ARENA_COUNT(examined, 1);
+      if(p->s.size < nunits)
+        continue;
+      if(fit == NULL
+         || (STRATEGY_IS(2) && p->s.size < fit->s.size)
+         || (STRATEGY_IS(3) && p->s.size > fit->s.size)) {
+        fit = p;
+        prevfit = prevp;
+        if(STRATEGY_IS(1) || (STRATEGY_IS(2) && p->s.size == nunits))
+          break;                                        /* can't do better */
+      }
+    }
+  if(fit == NULL)
+    return NULL;
+
+  if (fit->s.size == nunits)                            /* exactly */
+    prevfit->s.ptr = fit->s.ptr;
+  else {                                                /* allocate tail end */
+    fit->s.size -= nunits;
+    fit += fit->s.size;
+    NEWBLOCK(fit, nunits, 0);
+  }
+  freep = prevfit;
+  return fit;
+}
+#endif
+
+#if DEFER_FREE > 0
+/* Deferred free
+ *
+ * With DEFER_FREE free only pushes a block on a quick list, one per
+ * unit count below QUICK_UNITS and one for all bigger blocks, and
+ * malloc takes it back from there in O(1) for a request of the same
+ * size. The blocks stay marked in use, so their neighbours and the
+ * checks see no difference. Once DEFER_FREE blocks wait, or a request
+ * finds nothing on the free lists, consolidate sorts them by address
+ * and joins them to the free list in a single sweep.
+ */
+#define QUICK_UNITS 128                                 /* 2 KiB, bigger blocks wait for consolidate */
+
+static Header *quick[QUICK_UNITS + 1];                  /* the last list holds the bigger blocks */
+static size_t deferred = 0;                             /* blocks on the quick lists */
+
+#ifndef USE_BINS
+/* sortBlocks
+ *
+ * sortBlocks returns the list of blocks linked through s.ptr at list
+ * sorted by address, with a merge sort that needs no memory.
+ *
+ * @param    Header * list
+ */
+static Header *sortBlocks(Header *list)
+{
+  Header *a, *b, *p, *sorted, **tail;
+
+  if(list == NULL || list->s.ptr == NULL)
+    return list;
+  for(a = list, b = list->s.ptr; b != NULL && b->s.ptr != NULL; b = b->s.ptr->s.ptr)
+    a = a->s.ptr;                                       /* a ends in the middle */
+  b = a->s.ptr;
+  a->s.ptr = NULL;
+  a = sortBlocks(list);
+  b = sortBlocks(b);
+  for(tail = &sorted; a != NULL && b != NULL; tail = &p->s.ptr) {
+    if(a < b) {
+      p = a;
+      a = a->s.ptr;
+    }
+    else {
+      p = b;
+      b = b->s.ptr;
+    }
+    *tail = p;
+  }
+  *tail = a != NULL ? a : b;
+  return sorted;
+}
+#endif
+
+/* consolidate
+ *
+ * consolidate returns nothing, it empties the quick lists onto the
+ * free list. Sorted by address, each block is inserted from where the
+ * one before it went in, so all of them take one walk of the list.
+ * Segregated Fit and boundary tags need no walk and take them as
+ * they come. The arena lock must be held with THREADS.
+ */
+static void consolidate(void)
+{
+  Header *list = NULL, *bp, *next, *p;
+  unsigned i;
+#if TRIM_THRESHOLD > 0
+  char *end;
+#endif
+
+  if(deferred == 0)
+    return;
+  for(i = 0; i <= QUICK_UNITS; i++) {
+    for(bp = quick[i]; bp != NULL; bp = next) {
+      next = bp->s.ptr;
+      bp->s.ptr = list;
+      list = bp;
+    }
+    quick[i] = NULL;
+  }
+  deferred = 0;
+  ARENA_COUNT(consolidations, 1);
+#ifndef USE_BINS
+  list = sortBlocks(list);
+  p = freep;
+#endif
+  for(bp = list; bp != NULL; bp = next) {
+    next = bp->s.ptr;
+#if TRIM_THRESHOLD > 0
+    end = (char *)(bp + bp->s.size);
+#endif
+#ifdef USE_BINS
+    p = freeBlock(bp);
+#else
+    p = listInsert(p, bp);                              /* from where the last one went in */
+#endif
+#if TRIM_THRESHOLD > 0
+    trimBlock(p, (char *) bp, end);
+#endif
+  }
+}
+
+/* deferBlock
+ *
+ * deferBlock returns nothing, it puts the freed block bp on its quick
+ * list, and consolidates them all once DEFER_FREE blocks wait.
+ *
+ * @param    Header * bp
+ */
+static void deferBlock(Header *bp)
+{
+  Header **list = &quick[bp->s.size < QUICK_UNITS ? bp->s.size : QUICK_UNITS];
+
+  bp->s.ptr = *list;
+  *list = bp;
+  if(++deferred >= DEFER_FREE)
+    consolidate();
+}
+#endif
+
+/* releaseBlock
+ *
+ * releaseBlock returns nothing, it gives the block bp back to the
+ * arena the way free does, on a quick list with DEFER_FREE, or else
+ * to the free list, trimming the block it ends up in once that is
+ * big enough. The arena lock must be held with THREADS.
+ *
+ * @param    Header * bp
+ */
+static void releaseBlock(Header *bp)
+{
+#if DEFER_FREE > 0
+  deferBlock(bp);
+#elif TRIM_THRESHOLD > 0
+  char *end = (char *)(bp + bp->s.size);
+
+  trimBlock(freeBlock(bp), (char *) bp, end);
+#else
+  freeBlock(bp);
+#endif
+}
+
+/* allocate
+ *
+ * allocate returns a pointer to the allocated area. 
+ * If STRATEGY is defined the execution path may vary
+ * depending on the value of the variable.
+ *
+ * @param    size_t nbytes
+ */
+static void * allocate(size_t nbytes)
+{
+
+  Header *p;
+  Header * morecore(size_t);
+  size_t nunits;
+
+  if(nbytes <= 0) return NULL;
+
+  nunits = NUNITS(nbytes);
+
+  if(freep == NULL) {
+    base.s.ptr = freep = &base;
+    base.s.size = 0;
+#if STRATEGY == 0
+    strategy = pickStrategy();
+#endif
+  }
+#if DEFER_FREE > 0
+  if(nunits < QUICK_UNITS && (p = quick[nunits]) != NULL) {
+    quick[nunits] = p->s.ptr;                           /* freed at this size, still marked in use */
+    deferred--;
+    ARENA_COUNT(quickHits, 1);
+    return PAYLOAD(p);
+  }
+#endif
+
+  /* Segregated Fit and boundary tags keep free blocks in bins */
+  for(;;) {
+    ARENA_COUNT(searches, 1);
+#ifdef USE_BINS
+    if((p = binTake(nunits)) != NULL)
+#else
+    if((p = listTake(nunits)) != NULL)
+#endif
+      return PAYLOAD(p);
+#if DEFER_FREE > 0
+    if(deferred > 0) {                                  /* the blocks held back may do */
+      consolidate();
+      continue;
+    }
+#endif
+    if(morecore(nunits) == NULL)
+      return NULL;                                      /* none left */
+  }
+}
+
+/* Slabs
+ *
+ * A slab is a page cut into objects of a single size, with no header
+ * per object. The struct slab at the start of the page is found from
+ * the address of any object in it. Slab pages come from a region of
+ * their own, reserved once and committed SLAB_COMMIT pages at a time
+ * like the heap in morecore, so free knows a slab object by its
+ * address. A pool hands out objects from its slabs, a slab with none
+ * left free moves to the full list and an empty one is kept for the
+ * next time or given back.
+ */
+#ifndef SLAB_RESERVE
+#define SLAB_RESERVE (256*1024*1024)                    /* bytes of address space for slabs */
+#endif
+#define SLAB_COMMIT 16                                  /* pages committed at a time */
+#define SLAB_BITS (8*sizeof(unsigned long))
+#define SLAB_WORDS (SLAB_RESERVE/4096/SLAB_BITS)        /* pages are at least 4 KiB */
+
+struct slab {                                           /* at the start of every slab page */
+  struct pool *pool;
+  struct slab *next, *prev;                             /* on the pool's partial or full list */
+  void *free;                                           /* freed objects, linked through their first word */
+  char *bump;                                           /* objects never handed out start here */
+  unsigned used, nobjs;
+};
+
+struct pool {
+  size_t size;                                          /* of an object */
+  struct slab *partial, *full;
+  struct slab *empty;                                   /* kept for when the next slab is needed */
+#ifdef THREADS
+  pthread_mutex_t lock;
+#endif
+};
+
+#define SLAB_HEADER ((sizeof(struct slab) + sizeof(Header)-1)/sizeof(Header)*sizeof(Header))
+#define SLAB(ap)    ((struct slab *) PAGE_DOWN(ap))
+#define IS_SLAB(ap) ((char *)(ap) >= slabBase && (char *)(ap) < slabEnd)
+#if CHECKS & CHECK_HEADER
+#define SLAB_FREED(ap) ((void *) ~((unsigned long)(ap) ^ (unsigned long) &base))  /* second word once freed */
+#endif
+
+static char *slabBase = NULL, *slabEnd = NULL;          /* reserved for slabs */
+static char *slabTop = NULL;                            /* committed up to here */
+static int slabNone = 0;                                /* the reservation failed */
+static unsigned long slabMap[SLAB_WORDS];               /* bit set for each free committed page */
+static size_t slabHint = 0;                             /* no bits set in the words below it */
+static size_t slabIdle = 0;                             /* free pages not given back yet */
+
+/* slabPage
+ *
+ * slabPage returns a page of the slab region to make a new slab of,
+ * or NULL if the region is used up. Pages given back by slabRelease
+ * are taken first, then more are committed.
+ */
+static struct slab *slabPage(void)
+{
+  size_t page = getpagesize(), i, len;
+  char *p = NULL, *q;
+
+#ifdef THREADS
+  lockArena();
+#endif
+  if(slabBase == NULL && !slabNone) {
+    q = mmap(NULL, SLAB_RESERVE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if(q == MAP_FAILED)
+      slabNone = 1;
+    else {
+      slabTop = slabBase = q;
+      slabEnd = q + SLAB_RESERVE;
+    }
+  }
+  for(i = slabHint; i < SLAB_WORDS; i++)
+    if(slabMap[i] != 0) {
+      p = slabBase + (i*SLAB_BITS + __builtin_ctzl(slabMap[i]))*page;
+      slabMap[i] &= slabMap[i] - 1;
+      if(slabIdle > 0)
+        slabIdle--;
+      break;
+    }
+  slabHint = i;
+  if(p == NULL && slabTop < slabEnd) {
+    len = SLAB_COMMIT*page;
+    if(len > (size_t)(slabEnd - slabTop))
+      len = slabEnd - slabTop;
+    if(mprotect(slabTop, len, PROT_READ | PROT_WRITE) == 0) {
+      p = slabTop;
+      slabTop += len;
+      for(q = p + page; q < slabTop; q += page) {       /* the rest are free */
+        i = (q - slabBase)/page;
+        slabMap[i/SLAB_BITS] |= 1UL << i%SLAB_BITS;
+      }
+      slabHint = (p + page - slabBase)/page/SLAB_BITS;
+    }
+  }
+  if(p != NULL)
+    ARENA_COUNT(slabBytes, page);
+#ifdef THREADS
+  unlockArena();
+#endif
+  return (struct slab *) p;
+}
+
+#if TRIM_THRESHOLD > 0
+/* slabTrim
+ *
+ * slabTrim returns 1 if free slab pages were given back to the system
+ * with madvise, a run of them at a time, and 0 otherwise. With THREADS
+ * the arena lock must be held.
+ */
+static int slabTrim(void)
+{
+  size_t page = getpagesize(), n = (slabTop - slabBase)/page, i, j;
+  int released = 0;
+
+  for(i = 0; i < n; i = j+1) {
+    for(j = i; j < n && slabMap[j/SLAB_BITS] >> j%SLAB_BITS & 1; j++)
+      ;
+    if(j > i)
+      released |= madvise(slabBase + i*page, (j-i)*page, MADV_DONTNEED) == 0;
+  }
+  slabIdle = 0;
+  return released;
+}
+#endif
+
+/* slabRelease
+ *
+ * slabRelease returns nothing, it marks the page of the empty slab sp
+ * free for slabPage. Once free pages add up to the trim threshold
+ * they are given back to the system.
+ *
+ * @param    struct slab * sp
+ */
+static void slabRelease(struct slab *sp)
+{
+  size_t page = getpagesize(), i = ((char *) sp - slabBase)/page;
+
+#ifdef THREADS
+  lockArena();
+#endif
+  slabMap[i/SLAB_BITS] |= 1UL << i%SLAB_BITS;
+  if(i/SLAB_BITS < slabHint)
+    slabHint = i/SLAB_BITS;
+  ARENA_COUNT(slabBytes, -(size_t) page);
+#if TRIM_THRESHOLD > 0
+  if(++slabIdle*page >= getTrimThreshold())
+    slabTrim();
+#endif
+#ifdef THREADS
+  unlockArena();
+#endif
+}
+
+static void slabPush(struct slab **list, struct slab *sp)
+{
+  sp->prev = NULL;
+  if((sp->next = *list) != NULL)
+    sp->next->prev = sp;
+  *list = sp;
+}
+
+static void slabUnlink(struct slab **list, struct slab *sp)
+{
+  if(sp->prev != NULL)
+    sp->prev->next = sp->next;
+  else
+    *list = sp->next;
+  if(sp->next != NULL)
+    sp->next->prev = sp->prev;
+}
+
+/* poolInit
+ *
+ * poolInit returns nothing, it makes pool an empty pool of objects
+ * of size bytes.
+ *
+ * @param    struct pool * pool
+ * @param    size_t size
+ */
+static void poolInit(struct pool *pool, size_t size)
+{
+  memset(pool, 0, sizeof(*pool));
+  pool->size = size;
+#ifdef THREADS
+  pthread_mutex_init(&pool->lock, NULL);
+#endif
+}
+
+/* poolTake
+ *
+ * poolTake returns an object of pool, or NULL if no slab page can
+ * be had. With THREADS the pool's lock must be held.
+ *
+ * @param    struct pool * pool
+ */
+static void *poolTake(struct pool *pool)
+{
+  struct slab *sp = pool->partial;
+  void *obj;
+
+  if(sp == NULL) {
+    if((sp = pool->empty) != NULL)
+      pool->empty = NULL;
+    else {
+      if((sp = slabPage()) == NULL)
+        return NULL;
+      sp->pool = pool;
+      sp->free = NULL;
+      sp->bump = (char *) sp + SLAB_HEADER;
+      sp->used = 0;
+      sp->nobjs = (getpagesize() - SLAB_HEADER)/pool->size;
+    }
+    slabPush(&pool->partial, sp);
+  }
+  if((obj = sp->free) != NULL)
+    sp->free = *(void **) obj;
+  else {
+    obj = sp->bump;
+    sp->bump += pool->size;
+  }
+  if(++sp->used == sp->nobjs) {
+    slabUnlink(&pool->partial, sp);
+    slabPush(&pool->full, sp);
+  }
+  return obj;
+}
+
+/* poolPut
+ *
+ * poolPut returns nothing, it gives obj back to the slab sp it came
+ * from. With THREADS the lock of the slab's pool must be held.
+ *
+ * @param    struct slab * sp
+ * @param    void * obj
+ */
+static void poolPut(struct slab *sp, void *obj)
+{
+  struct pool *pool = sp->pool;
+
+  *(void **) obj = sp->free;
+  sp->free = obj;
+  if(sp->used-- == sp->nobjs) {                         /* was full */
+    slabUnlink(&pool->full, sp);
+    slabPush(&pool->partial, sp);
+  }
+  if(sp->used == 0) {
+    slabUnlink(&pool->partial, sp);
+    if(pool->empty == NULL)
+      pool->empty = sp;
+    else
+      slabRelease(sp);
+  }
+}
+
+#if SLAB_MAX > 0
+static struct pool classes[NCLASSES];                   /* malloc's, for 1..NCLASSES units */
+#ifdef THREADS
+static pthread_once_t classesOnce = PTHREAD_ONCE_INIT;
+#endif
+
+static void classesInit(void)
+{
+  unsigned i;
+
+  for(i = 0; i < NCLASSES; i++)
+    poolInit(&classes[i], (i+1)*sizeof(Header));
+}
+#endif
+
+#ifdef THREADS
+#define TCACHE_BINS 128                                 /* cache blocks below 128 units */
+#define TCACHE_COUNT 32                                 /* at most this many blocks per bin */
+#define TCACHE_REFILL 8                                 /* blocks fetched per trip to the arena */
+
+struct tcache {
+  Header *bins[TCACHE_BINS];                            /* in-use blocks, linked through s.ptr */
+  unsigned count[TCACHE_BINS];
+#if SLAB_MAX > 0
+  void *objs[NCLASSES];                                 /* slab objects, linked through their first word */
+  unsigned nobjs[NCLASSES];
+#endif
+  int registered;                                       /* 1 flushed by destructor at thread exit, */
+                                                        /* 0 not yet or again, -1 no longer used */
+  unsigned destroyed;                                   /* times tcacheDestroy ran */
+};
+
+static __thread struct tcache tcache                    /* per thread, no locking needed */
+  __attribute__((tls_model("initial-exec")));           /* never allocates, even in a preloaded library */
+static pthread_once_t tcacheOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t tcacheKey;
+
+/* tcacheFlush
+ *
+ * tcacheFlush returns nothing, it hands all but keep blocks of
+ * cache bin i back to the shared arena under a single lock.
+ *
+ * @param    struct tcache * tc
+ * @param    unsigned i
+ * @param    unsigned keep
+ */
+static void tcacheFlush(struct tcache *tc, unsigned i, unsigned keep)
+{
+  Header *p;
+
+  lockArena();
+  while(tc->count[i] > keep) {
+    p = tc->bins[i];
+    tc->bins[i] = p->s.ptr;
+    tc->count[i]--;
+    COUNT(cachedBlocks, -1);
+    COUNT(cachedBytes, -(size_t) i*sizeof(Header));
+    releaseBlock(p);
+  }
+  unlockArena();
+}
+
+#if SLAB_MAX > 0
+/* tcacheFlushObjs
+ *
+ * tcacheFlushObjs returns nothing, it hands all but keep objects of
+ * slab class c back to their pool under a single lock.
+ *
+ * @param    struct tcache * tc
+ * @param    unsigned c
+ * @param    unsigned keep
+ */
+static void tcacheFlushObjs(struct tcache *tc, unsigned c, unsigned keep)
+{
+  void *obj;
+
+  pthread_mutex_lock(&classes[c].lock);
+  while(tc->nobjs[c] > keep) {
+    obj = tc->objs[c];
+    tc->objs[c] = *(void **) obj;
+    tc->nobjs[c]--;
+    COUNT(cachedBlocks, -1);
+    COUNT(cachedBytes, -(size_t) classes[c].size);
+    poolPut(SLAB(obj), obj);
+  }
+  pthread_mutex_unlock(&classes[c].lock);
+}
+#endif
+
+#if STATS
+/* addStats
+ *
+ * addStats returns nothing, it adds the counters of from to sum.
+ *
+ * @param    struct threadStats * sum
+ * @param    struct threadStats * from
+ */
+static void addStats(struct threadStats *sum, struct threadStats *from)
+{
+  unsigned i;
+
+  sum->mallocs += from->mallocs;
+  sum->frees += from->frees;
+  sum->cacheHits += from->cacheHits;
+  sum->maps += from->maps;
+  sum->unmaps += from->unmaps;
+  sum->mappedBytes += from->mappedBytes;
+  sum->cachedBlocks += from->cachedBlocks;
+  sum->cachedBytes += from->cachedBytes;
+  for(i = 0; i < NSIZES; i++)
+    sum->sizes[i] += from->sizes[i];
+}
+
+/* retireStats
+ *
+ * retireStats returns nothing, it moves the counters of the thread
+ * owning ts off statsList and into retiredStats. The arena lock
+ * must be held.
+ *
+ * @param    struct threadStats * ts
+ */
+static void retireStats(struct threadStats *ts)
+{
+  struct threadStats **pp;
+
+  for(pp = &statsList; *pp != NULL; pp = &(*pp)->next)
+    if(*pp == ts) {
+      *pp = ts->next;
+      addStats(&retiredStats, ts);
+      memset(ts, 0, sizeof(*ts));
+      break;
+    }
+}
+#endif
+
+/* tcacheDestroy
+ *
+ * tcacheDestroy returns nothing, it is run by pthreads when a
+ * thread exits and gives its cached blocks back to the arena. The
+ * destructors of other keys may still call malloc and free, so the
+ * cache is left unregistered: the next call registers it again and
+ * pthreads runs tcacheDestroy once more. Once pthreads would not,
+ * the cache is no longer used and blocks go straight to the arena,
+ * uncounted.
+ *
+ * @param    void * arg
+ */
+static void tcacheDestroy(void *arg)
+{
+  struct tcache *tc = arg;
+  unsigned i;
+
+  for(i = 0; i < TCACHE_BINS; i++)
+    if(tc->count[i] > 0)
+      tcacheFlush(tc, i, 0);
+#if SLAB_MAX > 0
+  for(i = 0; i < NCLASSES; i++)
+    if(tc->nobjs[i] > 0)
+      tcacheFlushObjs(tc, i, 0);
+#endif
+#if STATS
+  lockArena();
+  retireStats(&stats);
+  unlockArena();
+#endif
+#ifdef TRACE
+  traceFlush();
+#endif
+  tc->registered = ++tc->destroyed < PTHREAD_DESTRUCTOR_ITERATIONS ? 0 : -1;
+}
+
+/* The slab class locks and then the arena lock are held across fork
+ * so the child never inherits them locked. */
+static void atforkPrepare(void)
+{
+#if SLAB_MAX > 0
+  unsigned i;
+
+  pthread_once(&classesOnce, classesInit);
+  for(i = 0; i < NCLASSES; i++)
+    pthread_mutex_lock(&classes[i].lock);
+#endif
+  lockArena();
+}
+
+static void atforkParent(void)
+{
+#if SLAB_MAX > 0
+  unsigned i;
+
+  for(i = 0; i < NCLASSES; i++)
+    pthread_mutex_unlock(&classes[i].lock);
+#endif
+  unlockArena();
+}
+
+static void atforkChild(void)
+{
+#if SLAB_MAX > 0
+  unsigned i;
+
+  for(i = 0; i < NCLASSES; i++)
+    pthread_mutex_init(&classes[i].lock, NULL);
+#endif
+#if STATS
+  while(statsList != NULL && statsList->next != NULL)   /* the other threads are gone */
+    retireStats(statsList == &stats ? statsList->next : statsList);
+#endif
+  pthread_mutex_init(&arenaLock, NULL);
+}
+
+static void tcacheInit(void)
+{
+  pthread_key_create(&tcacheKey, tcacheDestroy);
+  pthread_atfork(atforkPrepare, atforkParent, atforkChild);
+}
+
+/* tcacheRegister
+ *
+ * tcacheRegister returns nothing, it arranges for tcacheDestroy to
+ * run when the calling thread exits and puts its counters on statsList.
+ */
+static void tcacheRegister(void)
+{
+  pthread_once(&tcacheOnce, tcacheInit);
+  pthread_setspecific(tcacheKey, &tcache);
+  tcache.registered = 1;
+#if STATS
+  lockArena();
+  stats.next = statsList;
+  statsList = &stats;
+  unlockArena();
+#endif
+}
+
+/* tcachePush
+ *
+ * tcachePush returns 1 if the block bp was put in the cache of the
+ * calling thread and 0 if it is too big to be cached. A full bin is
+ * halved by giving blocks back to the arena first.
+ *
+ * @param    Header * bp
+ */
+static int tcachePush(Header *bp)
+{
+  size_t i = bp->s.size;
+
+  if(i >= TCACHE_BINS || tcache.registered < 0) return 0;
+  if(!tcache.registered)
+    tcacheRegister();
+  if(tcache.count[i] == TCACHE_COUNT)                   /* overflow */
+    tcacheFlush(&tcache, i, TCACHE_COUNT/2);
+  bp->s.ptr = tcache.bins[i];
+  tcache.bins[i] = bp;
+  tcache.count[i]++;
+  COUNT(cachedBlocks, 1);
+  COUNT(cachedBytes, i*sizeof(Header));
+  return 1;
+}
+
+/* tcachePop
+ *
+ * tcachePop returns a cached block of exactly nunits units, or
+ * NULL if the bin is empty. It never takes the arena lock.
+ *
+ * @param    size_t nunits
+ */
+static Header *tcachePop(size_t nunits)
+{
+  Header *p;
+
+  if(nunits >= TCACHE_BINS || (p = tcache.bins[nunits]) == NULL)
+    return NULL;
+  tcache.bins[nunits] = p->s.ptr;
+  tcache.count[nunits]--;
+  COUNT(cachedBlocks, -1);
+  COUNT(cachedBytes, -(size_t) nunits*sizeof(Header));
+  return p;
+}
+
+/* tcacheRefill
+ *
+ * tcacheRefill returns a block for a request of nbytes that missed
+ * the cache. For cached sizes a few more blocks of the same size are
+ * taken from the arena while the lock is held anyway.
+ *
+ * @param    size_t nbytes
+ */
+static void *tcacheRefill(size_t nbytes)
+{
+  void *ap;
+  Header *p;
+  unsigned n;
+
+  if(!tcache.registered)                                /* so tcacheDestroy gives back what is cached */
+    tcacheRegister();
+  lockArena();
+  ap = allocate(nbytes);
+  if(ap != NULL && NUNITS(nbytes) < TCACHE_BINS && tcache.registered > 0)
+    for(n = 1; n < TCACHE_REFILL; n++) {
+      if((p = allocate(nbytes)) == NULL)
+        break;
+      p = BLOCK(p);
+      if(p->s.size >= TCACHE_BINS || tcache.count[p->s.size] == TCACHE_COUNT) {
+        releaseBlock(p);
+        break;
+      }
+      p->s.ptr = tcache.bins[p->s.size];
+      tcache.bins[p->s.size] = p;
+      tcache.count[p->s.size]++;
+      COUNT(cachedBlocks, 1);
+      COUNT(cachedBytes, p->s.size*sizeof(Header));
+    }
+  unlockArena();
+  return ap;
+}
+#endif
+
+#if SLAB_MAX > 0
+/* slabAlloc
+ *
+ * slabAlloc returns an object of the smallest slab class holding
+ * nbytes, or NULL if the slab region is used up. With THREADS the
+ * calling thread's cache is tried first, a miss takes a few objects
+ * at once under the class lock.
+ *
+ * @param    size_t nbytes
+ */
+static void * slabAlloc(size_t nbytes)
+{
+  unsigned c = (nbytes-1)/sizeof(Header);
+  void *obj;
+#ifdef THREADS
+  void *more;
+  unsigned n;
+
+  if((obj = tcache.objs[c]) != NULL) {
+    tcache.objs[c] = *(void **) obj;
+    tcache.nobjs[c]--;
+    COUNT(cacheHits, 1);
+    COUNT(cachedBlocks, -1);
+    COUNT(cachedBytes, -(size_t) classes[c].size);
+    return obj;
+  }
+  if(!tcache.registered)                                /* so tcacheDestroy gives back what is cached */
+    tcacheRegister();
+  pthread_once(&classesOnce, classesInit);
+  pthread_mutex_lock(&classes[c].lock);
+  obj = poolTake(&classes[c]);
+  for(n = 1; obj != NULL && tcache.registered > 0 && n < TCACHE_REFILL && tcache.nobjs[c] < TCACHE_COUNT; n++) {
+    if((more = poolTake(&classes[c])) == NULL)
+      break;
+    *(void **) more = tcache.objs[c];
+    tcache.objs[c] = more;
+    tcache.nobjs[c]++;
+    COUNT(cachedBlocks, 1);
+    COUNT(cachedBytes, classes[c].size);
+  }
+  pthread_mutex_unlock(&classes[c].lock);
+#else
+  if(classes[0].size == 0)
+    classesInit();
+  obj = poolTake(&classes[c]);
+#endif
+  return obj;
+}
+
+/* slabFree
+ *
+ * slabFree returns nothing, it gives the slab object ap back to its
+ * pool, or with THREADS to the calling thread's cache. Objects of
+ * pools made by pool_create, and those freed by an exiting thread
+ * whose cache is no longer used, go straight back to their pool.
+ *
+ * @param    void * ap
+ */
+static void slabFree(void *ap)
+{
+  struct slab *sp = SLAB(ap);
+#ifdef THREADS
+  struct pool *pool = sp->pool;
+  unsigned c;
+
+  if(pool < classes || pool >= classes + NCLASSES || tcache.registered < 0) {
+    pthread_mutex_lock(&pool->lock);
+    poolPut(sp, ap);
+    pthread_mutex_unlock(&pool->lock);
+    return;
+  }
+  c = pool - classes;
+  if(!tcache.registered)
+    tcacheRegister();
+  if(tcache.nobjs[c] == TCACHE_COUNT)                   /* overflow */
+    tcacheFlushObjs(&tcache, c, TCACHE_COUNT/2);
+  *(void **) ap = tcache.objs[c];
+  tcache.objs[c] = ap;
+  tcache.nobjs[c]++;
+  COUNT(cachedBlocks, 1);
+  COUNT(cachedBytes, pool->size);
+#else
+  poolPut(sp, ap);
+#endif
+}
+#endif
+
+#if (CHECKS & CHECK_POINTER) && MMAP_THRESHOLD > 0
+/* Mapped blocks
+ *
+ * For CHECK_POINTER the headers of the blocks with mappings of their
+ * own are kept in a hash table, so that a pointer outside the heap is
+ * only taken for one of them if it is, without reading memory that may
+ * not be mapped at all. The table lives in a mapping of its own, with
+ * linear probing, and is rebuilt twice as big once three quarters of
+ * it are taken. With THREADS it is guarded by the arena lock, which is
+ * held across a move so there is always room for the new place.
+ */
+#define GONE ((Header *) 1)                             /* a removed entry, probes go on past it */
+
+static Header **mapped = NULL;
+static size_t mappedSize = 0, mappedUsed = 0;           /* slots, and those not NULL */
+
+static size_t mappedSlot(Header *bp)
+{
+  return ((unsigned long) bp >> 3) * 0x9e3779b97f4a7c15UL >> 24 & (mappedSize - 1);
+}
+
+/* findMapped
+ *
+ * findMapped returns the slot of the table holding bp, or NULL if bp
+ * is not the header of a mapped block.
+ *
+ * @param    Header * bp
+ */
+static Header **findMapped(Header *bp)
+{
+  size_t i;
+
+  if(mapped == NULL)
+    return NULL;
+  for(i = mappedSlot(bp); mapped[i] != NULL; i = (i + 1) & (mappedSize - 1))
+    if(mapped[i] == bp)
+      return &mapped[i];
+  return NULL;
+}
+
+/* mappedLock
+ *
+ * mappedLock returns 0 with the arena lock held (with THREADS) and
+ * room in the table for one more entry, or -1 if the table could not
+ * grow. The removed entries are dropped when it does.
+ */
+static int mappedLock(void)
+{
+  Header **old = mapped, **p;
+  size_t oldSize = mappedSize, size, i;
+
+#ifdef THREADS
+  lockArena();
+#endif
+  if(4*(mappedUsed + 1) <= 3*mappedSize)
+    return 0;
+  size = mappedSize ? 2*mappedSize : getpagesize()/sizeof(Header *);
+  p = mmap(NULL, size*sizeof(Header *), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(p == MAP_FAILED) {
+#ifdef THREADS
+    unlockArena();
+#endif
+    return -1;
+  }
+  mapped = p;
+  mappedSize = size;
+  mappedUsed = 0;
+  for(i = 0; i < oldSize; i++)
+    if(old[i] != NULL && old[i] != GONE) {
+      for(p = &mapped[mappedSlot(old[i])]; *p != NULL; p = p == &mapped[size-1] ? mapped : p+1)
+        ;
+      *p = old[i];
+      mappedUsed++;
+    }
+  if(old != NULL)
+    munmap(old, oldSize*sizeof(Header *));
+  return 0;
+}
+
+/* mappedUnlock
+ *
+ * mappedUnlock returns nothing, it replaces the entry old in the table
+ * by bp, either of which may be NULL, and releases what mappedLock
+ * took.
+ *
+ * @param    Header * old
+ * @param    Header * bp
+ */
+static void mappedUnlock(Header *old, Header *bp)
+{
+  Header **p;
+
+  if(old != NULL && (p = findMapped(old)) != NULL)
+    *p = GONE;
+  if(bp != NULL) {
+    for(p = &mapped[mappedSlot(bp)]; *p != NULL && *p != GONE; p = p == &mapped[mappedSize-1] ? mapped : p+1)
+      ;
+    if(*p == NULL)
+      mappedUsed++;
+    *p = bp;
+  }
+#ifdef THREADS
+  unlockArena();
+#endif
+}
+
+/* isMapped
+ *
+ * isMapped returns 1 if bp is the header of a block with a mapping of
+ * its own, and 0 otherwise.
+ *
+ * @param    Header * bp
+ */
+static int isMapped(Header *bp)
+{
+  int found;
+
+#ifdef THREADS
+  lockArena();
+#endif
+  found = findMapped(bp) != NULL;
+#ifdef THREADS
+  unlockArena();
+#endif
+  return found;
+}
+#endif
+
+#if MMAP_THRESHOLD > 0
+/* mapBlock
+ *
+ * mapBlock returns a pointer to an area of nbytes in a mapping of
+ * its own, marked MMAPPED in the header so free can munmap it. The
+ * mapping starts at the page holding the header (which alignedAlloc
+ * may move further into it) and ends at the page s.size units reach.
+ *
+ * @param    size_t nbytes
+ */
+static void * mapBlock(size_t nbytes)
+{
+  Header *p;
+  char *cp;
+  size_t len = (size_t) PAGE_UP(HDR + NUNITS(nbytes)*sizeof(Header));
+
+  cp = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(cp == MAP_FAILED)
+    return NULL;
+#if HUGEPAGES
+  if(len >= HUGE_PAGE)
+    madvise(cp, len, MADV_HUGEPAGE);
+#endif
+  p = (Header *)(cp + HDR);
+  NEWBLOCK(p, (len - HDR)/sizeof(Header), MMAPPED);
+  SEAL(p);
+#if CHECKS & CHECK_POINTER
+  if(mappedLock() != 0) {
+    munmap(cp, len);
+    return NULL;
+  }
+  mappedUnlock(NULL, p);
+#endif
+  COUNT(maps, 1);
+  COUNT(mappedBytes, len);
+  return PAYLOAD(p);
+}
+
+/* remapBlock
+ *
+ * remapBlock returns a pointer to the MMAPPED block bp resized to
+ * hold nbytes, or NULL if it cannot be resized. The kernel may move
+ * the pages but never copies them.
+ *
+ * @param    Header * bp
+ * @param    size_t nbytes
+ */
+static void * remapBlock(Header *bp, size_t nbytes)
+{
+#ifdef MREMAP_MAYMOVE
+  char *start = PAGE_DOWN(bp), *cp;
+  size_t offset = (char *) bp - start;
+  size_t oldlen = PAGE_UP(bp + bp->s.size) - start;
+  size_t len = (size_t) PAGE_UP(offset + NUNITS(nbytes)*sizeof(Header));
+
+#if CHECKS & CHECK_POINTER
+  if(mappedLock() != 0)
+    return NULL;
+#endif
+  cp = mremap(start, oldlen, len, MREMAP_MAYMOVE);
+  if(cp == MAP_FAILED) {
+#if CHECKS & CHECK_POINTER
+    mappedUnlock(NULL, NULL);
+#endif
+    return NULL;
+  }
+#if CHECKS & CHECK_POINTER
+  mappedUnlock(bp, (Header *)(cp + offset));
+#endif
+  COUNT(mappedBytes, len - oldlen);
+  bp = (Header *)(cp + offset);
+  bp->s.size = (len - offset)/sizeof(Header);
+  SEAL(bp);
+  return PAYLOAD(bp);
+#else
+  return NULL;
+#endif
+}
+#endif
+
+#if STATS
+/* sizeClass
+ *
+ * sizeClass returns the histogram slot of a request of nbytes, i for
+ * sizes up to 16 << i bytes, with everything bigger in the last one.
+ *
+ * @param    size_t nbytes
+ */
+static unsigned sizeClass(size_t nbytes)
+{
+  unsigned i;
+
+  if(nbytes <= 16)
+    return 0;
+  i = 8*sizeof(long) - __builtin_clzl(nbytes-1) - 4;
+  return i < NSIZES ? i : NSIZES-1;
+}
+#endif
+
+/* getblock
+ *
+ * getblock returns a pointer to the allocated area of a block with
+ * a header, see allocate. With THREADS the calling thread's cache is
+ * tried first, only a miss takes the arena lock. Requests of
+ * MMAP_THRESHOLD bytes or more skip the heap and get a mapping of
+ * their own.
+ *
+ * @param    size_t nbytes
+ */
+static void * getblock(size_t nbytes)
+{
+  void *ap;
+#ifdef THREADS
+  Header *p;
+#endif
+
+  if(TOO_BIG(nbytes))
+    return NULL;
+#if MMAP_THRESHOLD > 0
+  if(nbytes >= MMAP_THRESHOLD)
+    return mapBlock(nbytes);
+#endif
+#ifdef THREADS
+  if((p = tcachePop(NUNITS(nbytes))) != NULL) {
+    COUNT(cacheHits, 1);
+    ap = PAYLOAD(p);
+  }
+  else
+    ap = tcacheRefill(nbytes);
+#else
+  ap = allocate(nbytes);
+#endif
+  if(ap != NULL)
+    SEAL(BLOCK(ap));
+  return ap;
+}
+
+/* getmem
+ *
+ * getmem returns a pointer to the allocated area. Requests of up to
+ * SLAB_MAX bytes are served from slabs, the rest (and small ones
+ * once the slab region is used up) by getblock. Our own functions
+ * call getmem rather than malloc, since GCC turns malloc followed by
+ * memset into a call to calloc.
+ *
+ * @param    size_t nbytes
+ */
+static void * getmem(size_t nbytes)
+{
+#if SLAB_MAX > 0
+  void *ap;
+#endif
+
+  if(nbytes <= 0) return NULL;
+#if STATS
+  if(heapMapWanted)
+    heapMapDump();
+#endif
+#if STATS && defined(THREADS)
+  if(!tcache.registered)
+    tcacheRegister();
+#endif
+  COUNT(mallocs, 1);
+#if STATS
+  COUNT(sizes[sizeClass(nbytes)], 1);
+#endif
+#if SLAB_MAX > 0
+  if(nbytes <= SLAB_MAX && (ap = slabAlloc(nbytes)) != NULL) {
+#if CHECKS & CHECK_HEADER
+    ((void **) ap)[1] = NULL;                           /* not SLAB_FREED */
+#endif
+    return ap;
+  }
+#endif
+  return getblock(nbytes);
+}
+
+/* malloc
+ *
+ * malloc returns a pointer to the allocated area.
+ *
+ * @param    size_t nbytes
+ */
+void * malloc(size_t nbytes)
+{
+#ifdef TRACE
+  void *ap = getmem(nbytes);
+
+  traceCall(traceSeq(), TRACE_MALLOC, nbytes, NULL, ap);
+  return ap;
+#else
+  return getmem(nbytes);
+#endif
+}
+
+#if CHECKS & (CHECK_POINTER | CHECK_HEADER)
+/* checkFailed
+ *
+ * checkFailed does not return, it reports what is wrong with the
+ * pointer ap passed to func and aborts. The message is put together
+ * by hand, stdio could call malloc.
+ *
+ * @param    const char * func
+ * @param    const char * what
+ * @param    void * ap
+ */
+static void checkFailed(const char *func, const char *what, void *ap)
+{
+  char msg[128], *p = msg;
+  const char *s;
+  int i;
+
+  for(s = func; *s != '\0'; s++)
+    *p++ = *s;
+  for(s = "(): "; *s != '\0'; s++)
+    *p++ = *s;
+  for(s = what; *s != '\0'; s++)
+    *p++ = *s;
+  for(s = " at 0x"; *s != '\0'; s++)
+    *p++ = *s;
+  for(i = 8*sizeof(long) - 4; i >= 0; i -= 4)
+    *p++ = "0123456789abcdef"[(unsigned long) ap >> i & 15];
+  *p++ = '\n';
+  write(2, msg, p - msg);
+  abort();
+}
+
+/* checkPointer
+ *
+ * checkPointer returns nothing if ap, passed to func, looks like an
+ * area malloc handed out and has not freed since, and aborts the
+ * program otherwise. CHECK_POINTER makes sure ap is an object of a
+ * slab in use, or lies aligned in the heap, or is a mapped block in
+ * the table of them, before its header is read.
+ * CHECK_HEADER compares the seal, or the mark a freed slab object
+ * carries, see markFreed.
+ *
+ * @param    void * ap
+ * @param    const char * func
+ */
+static void checkPointer(void *ap, const char *func)
+{
+  Header *bp = BLOCK(ap);
+#if CHECKS & CHECK_POINTER
+  struct slab *sp = SLAB(ap);
+  size_t offset = (char *) ap - (char *) sp;
+#endif
+
+  if(IS_SLAB(ap)) {
+#if CHECKS & CHECK_POINTER
+    if((char *) ap >= slabTop || sp->pool == NULL || offset < SLAB_HEADER
+       || (offset - SLAB_HEADER) % sp->pool->size != 0 || (char *) ap >= sp->bump)
+      checkFailed(func, "pointer not from malloc", ap);
+#endif
+#if CHECKS & CHECK_HEADER
+    if(SLAB(ap)->pool->size >= 2*sizeof(void *) && ((void **) ap)[1] == SLAB_FREED(ap))
+      checkFailed(func, "double free", ap);
+#endif
+    return;
+  }
+#if CHECKS & CHECK_POINTER
+  if((unsigned long) ap % sizeof(Header) != 0)
+    checkFailed(func, "misaligned pointer", ap);
+#if MMAP_THRESHOLD > 0
+  if(((char *) bp < coreLow || (char *) ap >= coreHigh) && !isMapped(bp))
+#else
+  if((char *) bp < coreLow || (char *) ap >= coreHigh)
+#endif
+    checkFailed(func, "pointer not from malloc", ap);
+#endif
+#if CHECKS & CHECK_HEADER
+  if(bp->s.check != SEAL_OF(bp))
+    checkFailed(func, bp->s.check == (~SEAL_OF(bp) & ((1UL << CHECKBITS) - 1))
+                ? "double free" : "corrupt header or pointer not from malloc", ap);
+#endif
+}
+#endif
+
+#if CHECKS & (CHECK_HEADER | CHECK_POISON)
+/* markFreed
+ *
+ * markFreed returns nothing, it marks the area at ap freed for
+ * checkPointer and with CHECK_POISON fills it with POISON, before
+ * free puts its own links in. Mapped blocks are unmapped anyway.
+ *
+ * @param    void * ap
+ */
+static void markFreed(void *ap)
+{
+  Header *bp = BLOCK(ap);
+  size_t size;
+
+  if(IS_SLAB(ap)) {
+    size = SLAB(ap)->pool->size;
+#if CHECKS & CHECK_POISON
+    memset(ap, POISON, size);
+#endif
+#if CHECKS & CHECK_HEADER
+    if(size >= 2*sizeof(void *))
+      ((void **) ap)[1] = SLAB_FREED(ap);
+#endif
+    return;
+  }
+  UNSEAL(bp);
+#if CHECKS & CHECK_POISON
+  if(!(bp->s.flags & MMAPPED))
+    memset(ap, POISON, bp->s.size*sizeof(Header) - HDR);
+#endif
+}
+#endif
+
+/* putmem
+ *
+ * putmem returns nothing, it frees the area at ap, see free. Our
+ * own functions call putmem rather than free.
+ *
+ * @param    void * ap
+ */
+static void putmem(void * ap)
+{
+  Header *bp;
+
+  if(ap == NULL) return;                                /* Nothing to do */
+#if STATS
+  if(heapMapWanted)
+    heapMapDump();
+#endif
+
+  bp = BLOCK(ap);                                       /* point to block header */
+#if CHECKS & (CHECK_POINTER | CHECK_HEADER)
+  checkPointer(ap, "free");
+#endif
+#if CHECKS & (CHECK_HEADER | CHECK_POISON)
+  markFreed(ap);
+#endif
+#if STATS && defined(THREADS)
+  if(!tcache.registered)
+    tcacheRegister();
+#endif
+  COUNT(frees, 1);
+#if SLAB_MAX > 0
+  if(IS_SLAB(ap)) {
+    slabFree(ap);
+    return;
+  }
+#endif
+#if MMAP_THRESHOLD > 0
+  if(bp->s.flags & MMAPPED) {                           /* own mapping, give it back at once */
+    COUNT(unmaps, 1);
+    COUNT(mappedBytes, -(size_t)(PAGE_UP(bp + bp->s.size) - PAGE_DOWN(bp)));
+#if CHECKS & CHECK_POINTER
+#ifdef THREADS
+    lockArena();                                        /* a removal needs no room */
+#endif
+    mappedUnlock(bp, NULL);
+#endif
+    munmap(PAGE_DOWN(bp), PAGE_UP(bp + bp->s.size) - PAGE_DOWN(bp));
+    return;
+  }
+#endif
+#ifdef THREADS
+  if(tcachePush(bp))
+    return;
+  lockArena();
+#endif
+  releaseBlock(bp);
+#ifdef THREADS
+  unlockArena();
+#endif
+}
+
+/* free
+ *
+ * free returns nothing, it simply frees memory allocated by malloc.
+ * With THREADS small blocks stay in the calling thread's cache.
+ *
+ * @param    void * ap
+ */
+void free(void * ap)
+{
+#ifdef TRACE
+  if(ap != NULL)
+    traceCall(traceSeq(), TRACE_FREE, 0, ap, NULL);
+#endif
+  putmem(ap);
+}
+
+/* calloc
+ *
+ * calloc returns a pointer to an area of nmemb*size bytes set to
+ * zero. Blocks with a mapping of their own come straight from the
+ * kernel and are not cleared again. It has to be replaced along with malloc, the calloc in libc
+ * (which pthreads uses for its own bookkeeping) would otherwise hand
+ * out blocks from the libc heap that later reach our free.
+ *
+ * @param    size_t nmemb
+ * @param    size_t size
+ */
+void * calloc(size_t nmemb, size_t size)
+{
+  void *ap;
+
+  if(size != 0 && nmemb > (size_t)-1/size)              /* nmemb*size overflows */
+    return NULL;
+  ap = getmem(nmemb*size);
+#ifdef TRACE
+  traceCall(traceSeq(), TRACE_CALLOC, nmemb*size, NULL, ap);
+#endif
+  if(ap == NULL)
+    return NULL;
+#if MMAP_THRESHOLD > 0
+  if(!IS_SLAB(ap) && (BLOCK(ap)->s.flags & MMAPPED))   /* fresh pages are zero already */
+    return ap;
+#endif
+  memset(ap, 0, nmemb*size);
+  return ap;
+}
+
+/* growBlock
+ *
+ * growBlock returns 1 if the in-use block bp could be grown to at
+ * least nunits units without moving it, and 0 otherwise. The space
+ * comes from the free block right above bp, and if bp (or that free
+ * block) ends the heap, from morecore.
+ *
+ * @param    Header * bp
+ * @param    size_t nunits
+ */
+static int growBlock(Header *bp, size_t nunits)
+{
+#ifdef BOUNDARY_TAGS
+  Header *p = bp + bp->s.size;
+  size_t have = (p->s.flags & BT_FREE) ? p->s.size : 0;
+
+  if(bp->s.size + have < nunits) {                      /* not enough, try the top of the heap */
+    if(p + have != fencep || morecore(nunits - bp->s.size - have) == NULL)
+      return 0;
+  }
+  if(!(p->s.flags & BT_FREE) || bp->s.size + p->s.size < nunits)
+    return 0;                                           /* new region was not contiguous */
+  binUnlink(binIndex(p->s.size), NULL, p);
+  bp->s.size += p->s.size;
+  (bp + bp->s.size)->s.flags &= ~BT_PREVFREE;
+  return 1;
+#else
+  Header *p, *q;
+  size_t have;
+  int grown = 0;
+
+  for(;;) {
+    for(p = freep; !(bp > p && bp < p->s.ptr); p = p->s.ptr)
+      if(p >= p->s.ptr && (bp > p || bp < p->s.ptr))
+        break;                                          /* same walk as in free */
+    q = p->s.ptr;
+    have = (bp + bp->s.size == q) ? q->s.size : 0;
+    if(bp->s.size + have >= nunits)
+      break;
+    if(grown || bp + bp->s.size + have != CORE_TOP)
+      return 0;                                         /* not at the top of the heap */
+    if(morecore(nunits - bp->s.size - have) == NULL)
+      return 0;
+    grown = 1;                                          /* morecore joined it to the list, look again */
+  }
+
+  if(bp->s.size + have - nunits >= 2) {                 /* take the front of q, leave the rest free */
+    p->s.ptr = bp + nunits;
+    NEWBLOCK(p->s.ptr, have - (nunits - bp->s.size), 0);
+    p->s.ptr->s.ptr = q->s.ptr;
+    bp->s.size = nunits;
+  } else {
+    p->s.ptr = q->s.ptr;
+    bp->s.size += have;
+  }
+  freep = p;
+  return 1;
+#endif
+}
+
+/* resizeBlock
+ *
+ * resizeBlock returns 1 if the in-use block bp now holds nunits
+ * units without having moved, and 0 if the caller has to copy. A
+ * shrinking block gives its tail back to the free list.
+ *
+ * @param    Header * bp
+ * @param    size_t nunits
+ */
+static int resizeBlock(Header *bp, size_t nunits)
+{
+  Header *tail;
+
+  if(freep == NULL)                                     /* not one of ours */
+    return 0;
+  if(nunits > bp->s.size && !growBlock(bp, nunits))
+    return 0;
+  if(bp->s.size - nunits >= 2) {                        /* split off the tail and free it */
+    tail = bp + nunits;
+    NEWBLOCK(tail, bp->s.size - nunits, 0);
+    bp->s.size = nunits;
+    freeBlock(tail);
+  }
+  return 1;
+}
+
+/* reallocate
+ *
+ * reallocate returns a pointer to the reallocated area, see realloc.
+ * The block is shrunk or grown in place when possible, and only
+ * copied to a new area from getmem as a last resort.
+ *
+ * @param    void *ptr
+ * @param    size_t size
+ */
+static void * reallocate(void *ptr, size_t size){
+
+  if(ptr == NULL && size > 0){
+    ptr = getmem(size);
+    return ptr;
+  }
+
+  if(ptr != NULL && size == 0){
+    putmem(ptr);
+    return NULL;
+  }
+
+  if(ptr == NULL && size <= 0){
+    return NULL;
+  }
+
+#if CHECKS & (CHECK_POINTER | CHECK_HEADER)
+  checkPointer(ptr, "realloc");
+#endif
+
+  Header * headerPointer = BLOCK(ptr); /* För att få tillgång till header. */
+  int resized;
+
+  if(TOO_BIG(size)){
+    return NULL;
+  }
+
+  if(IS_SLAB(ptr)){ /* Objekt i en slab har ingen header. */
+    size_t objSize = SLAB(ptr)->pool->size;
+    void * newObject;
+    if(size <= objSize){
+      return ptr;
+    }
+    if((newObject = getmem(size)) == NULL){
+      return NULL;
+    }
+    memcpy(newObject,ptr,objSize);
+    putmem(ptr);
+    return newObject;
+  }
+
+#if MMAP_THRESHOLD > 0
+  if(headerPointer->s.flags & MMAPPED){
+    void * remapped = NULL;
+    if(size >= MMAP_THRESHOLD){
+      remapped = remapBlock(headerPointer, size);
+    }
+    if(remapped != NULL){
+      return remapped;
+    }
+  }
+  else{
+#endif
+#ifdef THREADS
+  lockArena();
+#endif
+  resized = resizeBlock(headerPointer, NUNITS(size));
+#ifdef THREADS
+  unlockArena();
+#endif
+  if(resized){
+    SEAL(headerPointer);
+    return ptr;
+  }
+#if MMAP_THRESHOLD > 0
+  }
+#endif
+
+  size_t old_size = headerPointer->s.size*sizeof(Header) - HDR;
+  Header * newAreaPointer = getmem(size); /* getmem tar size i bytes */
+
+  if(newAreaPointer == NULL){
+    return NULL; /* Det gamla blocket finns kvar. */
+  }
+  if(old_size <= size){
+    memcpy(newAreaPointer,ptr,old_size);
+  }
+  if(old_size > size){
+    memcpy(newAreaPointer,ptr,size);
+  }
+
+  putmem(ptr);
+
+  return newAreaPointer;
+}
+
+/* realloc
+ *
+ * realloc returns a pointer to the area at ptr resized to size
+ * bytes, moved if it had to be, or NULL if there was no memory
+ * left, in which case ptr is left alone.
+ *
+ * @param    void *ptr
+ * @param    size_t size
+ */
+void * realloc(void *ptr, size_t size)
+{
+#ifdef TRACE
+  unsigned long seq = traceSeq();
+  void *ap = reallocate(ptr, size);
+
+  traceCall(seq, TRACE_REALLOC, size, ptr, ap);
+  return ap;
+#else
+  return reallocate(ptr, size);
+#endif
+}
+
+/* getaligned
+ *
+ * getaligned returns a pointer to nbytes aligned to align, a power
+ * of two. A block big enough to hold an aligned area is taken and
+ * split: the part in front of the aligned header goes back on the
+ * free list (or back to the system for a mapped block) and so does
+ * the tail, so only the gap smaller than a unit is lost.
+ *
+ * @param    size_t align
+ * @param    size_t nbytes
+ */
+static void * getaligned(size_t align, size_t nbytes)
+{
+  Header *p, *np;
+  char *ap, *q;
+  size_t size;
+
+  if(align <= sizeof(Header))
+    return getmem(nbytes);
+  if(nbytes == 0 || nbytes > (size_t) -1 - align - 2*sizeof(Header))
+    return NULL;
+  size = nbytes + align + 2*sizeof(Header);
+  if(size <= SLAB_MAX)
+    size = SLAB_MAX + 1;                                /* a block with a header, the tail goes back */
+  if((ap = getmem(size)) == NULL)
+    return NULL;
+  p = BLOCK(ap);
+  q = (char *)(((unsigned long) ap + align-1) & ~(align-1));
+  if(q != ap && q - ap < 2*sizeof(Header))              /* the front must make a block of its own */
+    q += align;
+  np = BLOCK(q);
+
+#if MMAP_THRESHOLD > 0
+  if(p->s.flags & MMAPPED) {                            /* trim the mapping instead */
+    char *start = PAGE_DOWN(p), *end = PAGE_UP(p + p->s.size), *tail = PAGE_UP(q + nbytes + HDR);
+
+#if CHECKS & CHECK_POINTER
+    if(mappedLock() != 0) {
+      putmem(ap);
+      return NULL;
+    }
+    mappedUnlock(p, np);
+#endif
+    if(tail > end)
+      tail = end;
+    if(PAGE_DOWN(np) > start && munmap(start, PAGE_DOWN(np) - start) == 0)
+      COUNT(mappedBytes, -(size_t)(PAGE_DOWN(np) - start));
+    if(tail < end && munmap(tail, end - tail) == 0)
+      COUNT(mappedBytes, -(size_t)(end - tail));
+    NEWBLOCK(np, (tail - (char *) np)/sizeof(Header), MMAPPED);
+    SEAL(np);
+    return q;
+  }
+#endif
+
+#ifdef THREADS
+  lockArena();
+#endif
+  if(np != p) {                                         /* free the front */
+    NEWBLOCK(np, p->s.size - (np - p), 0);
+    p->s.size = np - p;
+    freeBlock(p);
+  }
+  resizeBlock(np, NUNITS(nbytes));                      /* and the tail */
+#ifdef THREADS
+  unlockArena();
+#endif
+  SEAL(np);
+  return q;
+}
+
+/* alignedAlloc
+ *
+ * alignedAlloc returns a pointer to nbytes aligned to align, see
+ * getaligned. All the aligned allocation functions end up here.
+ *
+ * @param    size_t align
+ * @param    size_t nbytes
+ */
+static void * alignedAlloc(size_t align, size_t nbytes)
+{
+#ifdef TRACE
+  void *ap = getaligned(align, nbytes);
+
+  traceCall(traceSeq(), TRACE_MEMALIGN, nbytes, (void *) align, ap);
+  return ap;
+#else
+  return getaligned(align, nbytes);
+#endif
+}
+
+/* posix_memalign
+ *
+ * posix_memalign returns 0 and sets *memptr to size bytes aligned to
+ * alignment, EINVAL if alignment is not a power of two multiple of
+ * sizeof(void *), or ENOMEM if there is no memory left.
+ *
+ * @param    void ** memptr
+ * @param    size_t alignment
+ * @param    size_t size
+ */
+int posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+  void *ap;
+
+  if(alignment % sizeof(void *) != 0 || (alignment & (alignment-1)) != 0)
+    return EINVAL;
+  if(size == 0) {
+    *memptr = NULL;
+    return 0;
+  }
+  if((ap = alignedAlloc(alignment, size)) == NULL)
+    return ENOMEM;
+  *memptr = ap;
+  return 0;
+}
+
+/* aligned_alloc
+ *
+ * aligned_alloc returns a pointer to size bytes aligned to alignment,
+ * or NULL with errno set to EINVAL if alignment is not a power of two.
+ *
+ * @param    size_t alignment
+ * @param    size_t size
+ */
+void * aligned_alloc(size_t alignment, size_t size)
+{
+  if(alignment == 0 || (alignment & (alignment-1)) != 0) {
+    errno = EINVAL;
+    return NULL;
+  }
+  return alignedAlloc(alignment, size);
+}
+
+/* memalign
+ *
+ * memalign returns a pointer to size bytes aligned to alignment,
+ * which is rounded up to a power of two like in glibc.
+ *
+ * @param    size_t alignment
+ * @param    size_t size
+ */
+void * memalign(size_t alignment, size_t size)
+{
+  size_t align = sizeof(Header);
+
+  while(align < alignment)
+    align <<= 1;
+  return alignedAlloc(align, size);
+}
+
+/* valloc, pvalloc
+ *
+ * valloc returns size bytes aligned to a page, pvalloc does the same
+ * with size rounded up to whole pages.
+ *
+ * @param    size_t size
+ */
+void * valloc(size_t size)
+{
+  return alignedAlloc(getpagesize(), size);
+}
+
+void * pvalloc(size_t size)
+{
+  return alignedAlloc(getpagesize(), (size_t) PAGE_UP(size));
+}
+
+/* malloc_usable_size
+ *
+ * malloc_usable_size returns how many bytes of the area at ap may be
+ * used, which can be more than was asked for.
+ *
+ * @param    void * ap
+ */
+size_t malloc_usable_size(void *ap)
+{
+  if(ap == NULL)
+    return 0;
+  if(IS_SLAB(ap))
+    return SLAB(ap)->pool->size;
+  return BLOCK(ap)->s.size*sizeof(Header) - HDR;
+}
+
+/* pool_create
+ *
+ * pool_create returns a new pool of objects of size bytes, or NULL
+ * if there is no memory left. Objects are aligned to sizeof(void *)
+ * and may not be bigger than a page less the slab header, otherwise
+ * errno is set to EINVAL.
+ *
+ * @param    size_t size
+ */
+struct pool * pool_create(size_t size)
+{
+  struct pool *pool;
+
+  if(size < sizeof(void *))
+    size = sizeof(void *);
+  size = (size + sizeof(void *)-1) & ~(sizeof(void *)-1);
+  if(size > getpagesize() - SLAB_HEADER) {
+    errno = EINVAL;
+    return NULL;
+  }
+  if((pool = getmem(sizeof(struct pool))) == NULL)
+    return NULL;
+  poolInit(pool, size);
+  return pool;
+}
+
+/* pool_alloc
+ *
+ * pool_alloc returns an object of pool, or NULL if no slab page can
+ * be had.
+ *
+ * @param    struct pool * pool
+ */
+void * pool_alloc(struct pool *pool)
+{
+  void *obj;
+
+#ifdef THREADS
+  pthread_mutex_lock(&pool->lock);
+#endif
+  obj = poolTake(pool);
+#ifdef THREADS
+  pthread_mutex_unlock(&pool->lock);
+#endif
+#if CHECKS & CHECK_HEADER
+  if(obj != NULL && pool->size >= 2*sizeof(void *))
+    ((void **) obj)[1] = NULL;                          /* free would take it for a double free */
+#endif
+  return obj;
+}
+
+/* pool_free
+ *
+ * pool_free returns nothing, it gives obj back to pool, which it
+ * must have come from.
+ *
+ * @param    struct pool * pool
+ * @param    void * obj
+ */
+void pool_free(struct pool *pool, void *obj)
+{
+  if(obj == NULL)
+    return;
+#ifdef THREADS
+  pthread_mutex_lock(&pool->lock);
+#endif
+  poolPut(SLAB(obj), obj);
+#ifdef THREADS
+  pthread_mutex_unlock(&pool->lock);
+#endif
+}
+
+/* pool_destroy
+ *
+ * pool_destroy returns nothing, it gives every slab of pool back at
+ * once, whether its objects were freed or not.
+ *
+ * @param    struct pool * pool
+ */
+void pool_destroy(struct pool *pool)
+{
+  struct slab *sp;
+
+  if(pool == NULL)
+    return;
+  while((sp = pool->partial) != NULL) {
+    pool->partial = sp->next;
+    slabRelease(sp);
+  }
+  while((sp = pool->full) != NULL) {
+    pool->full = sp->next;
+    slabRelease(sp);
+  }
+  if(pool->empty != NULL)
+    slabRelease(pool->empty);
+#ifdef THREADS
+  pthread_mutex_destroy(&pool->lock);
+#endif
+  putmem(pool);
+}
+
+/* Arenas
+ *
+ * An arena hands out memory by bumping a pointer through a chunk
+ * taken with getmem, and takes a new chunk twice the size of the
+ * last when it runs out. Nothing is freed on its own: arena_restore
+ * goes back to a mark from arena_save, arena_reset empties the arena
+ * and arena_destroy gives it all back, each by freeing chunks, never
+ * objects. An arena must only be used by one thread at a time.
+ */
+#define ARENA_CHUNK (64*1024)                           /* bytes in the first chunk by default */
+#define ARENA_MAXCHUNK (16*1024*1024)                   /* chunks stop doubling here */
+
+struct arenaChunk {
+  struct arenaChunk *prev;                              /* the chunk taken before this one */
+  size_t size;                                          /* bytes, this header included */
+};
+
+struct arena {
+  struct arenaChunk *chunk;                             /* the newest */
+  char *next, *end;                                     /* free part of the newest chunk */
+};
+
+#define CHUNK_START(c) ((char *)(c) + sizeof(Header))   /* keeps objects aligned like malloc's */
+
+/* arenaGrow
+ *
+ * arenaGrow returns 1 if a new chunk with room for nbytes was added
+ * to the arena a, and 0 if there is no memory left.
+ *
+ * @param    struct arena * a
+ * @param    size_t nbytes
+ */
+static int arenaGrow(struct arena *a, size_t nbytes)
+{
+  struct arenaChunk *c;
+  size_t size = a->chunk != NULL ? 2*a->chunk->size : ARENA_CHUNK;
+
+  if(size > ARENA_MAXCHUNK)
+    size = ARENA_MAXCHUNK;
+  if(size < nbytes + sizeof(Header))
+    size = nbytes + sizeof(Header);
+  if((c = getmem(size)) == NULL)
+    return 0;
+  c->prev = a->chunk;
+  c->size = size;
+  a->chunk = c;
+  a->next = CHUNK_START(c);
+  a->end = (char *) c + size;
+  return 1;
+}
+
+/* arena_create
+ *
+ * arena_create returns a new arena with a first chunk of size bytes
+ * (ARENA_CHUNK if size is 0), or NULL if there is no memory left.
+ *
+ * @param    size_t size
+ */
+struct arena * arena_create(size_t size)
+{
+  struct arena *a;
+
+  if((a = getmem(sizeof(struct arena))) == NULL)
+    return NULL;
+  a->chunk = NULL;
+  if(!arenaGrow(a, size != 0 ? size : ARENA_CHUNK - sizeof(Header))) {
+    putmem(a);
+    return NULL;
+  }
+  return a;
+}
+
+/* arena_alloc
+ *
+ * arena_alloc returns a pointer to nbytes taken from the arena a,
+ * aligned like malloc's, or NULL if there is no memory left.
+ *
+ * @param    struct arena * a
+ * @param    size_t nbytes
+ */
+void * arena_alloc(struct arena *a, size_t nbytes)
+{
+  char *ap;
+
+  if(nbytes > (size_t) -1 - sizeof(Header))
+    return NULL;
+  nbytes = (nbytes + sizeof(Header)-1) & ~(sizeof(Header)-1);
+  if(nbytes > (size_t)(a->end - a->next) && !arenaGrow(a, nbytes))
+    return NULL;
+  ap = a->next;
+  a->next += nbytes;
+  return ap;
+}
+
+/* arena_save
+ *
+ * arena_save returns a mark of how far the arena a has been used,
+ * for arena_restore. Marks nest: restoring one invalidates those
+ * saved after it.
+ *
+ * @param    struct arena * a
+ */
+struct arena_mark arena_save(struct arena *a)
+{
+  struct arena_mark m;
+
+  m.chunk = a->chunk;
+  m.next = a->next;
+  return m;
+}
+
+/* arena_restore
+ *
+ * arena_restore returns nothing, it frees everything taken from the
+ * arena a since the mark m was saved. Chunks taken since then are
+ * given back, the objects in them are not visited.
+ *
+ * @param    struct arena * a
+ * @param    struct arena_mark m
+ */
+void arena_restore(struct arena *a, struct arena_mark m)
+{
+  struct arenaChunk *c;
+
+  while(a->chunk != m.chunk) {
+    c = a->chunk;
+    a->chunk = c->prev;
+    putmem(c);
+  }
+  a->next = m.next;
+  a->end = (char *) a->chunk + a->chunk->size;
+}
+
+/* arena_reset
+ *
+ * arena_reset returns nothing, it frees everything taken from the
+ * arena a. Only the newest chunk, the biggest, is kept for reuse.
+ *
+ * @param    struct arena * a
+ */
+void arena_reset(struct arena *a)
+{
+  struct arenaChunk *c;
+
+  while((c = a->chunk->prev) != NULL) {
+    a->chunk->prev = c->prev;
+    putmem(c);
+  }
+  a->next = CHUNK_START(a->chunk);
+}
+
+/* arena_destroy
+ *
+ * arena_destroy returns nothing, it gives the arena a and every
+ * chunk of it back.
+ *
+ * @param    struct arena * a
+ */
+void arena_destroy(struct arena *a)
+{
+  struct arenaChunk *c;
+
+  if(a == NULL)
+    return;
+  while((c = a->chunk) != NULL) {
+    a->chunk = c->prev;
+    putmem(c);
+  }
+  putmem(a);
+}
+
+#if STATS
+/* sumStats
+ *
+ * sumStats returns nothing, it fills in sum with the counters of
+ * every thread that ever counted something. The arena lock must be
+ * held with THREADS, the counters of running threads may be off by
+ * the calls they are making meanwhile.
+ *
+ * @param    struct threadStats * sum
+ */
+static void sumStats(struct threadStats *sum)
+{
+#ifdef THREADS
+  struct threadStats *ts;
+
+  *sum = retiredStats;
+  for(ts = statsList; ts != NULL; ts = ts->next)
+    addStats(sum, ts);
+#else
+  *sum = stats;
+#endif
+}
+
+/* countFree
+ *
+ * countFree returns nothing, it adds the free block p to the sums
+ * freeStats keeps.
+ *
+ * @param    Header * p
+ * @param    size_t * bytes
+ * @param    size_t * largest
+ * @param    size_t * top
+ */
+static void countFree(Header *p, size_t *bytes, size_t *largest, size_t *top)
+{
+  *bytes += p->s.size*sizeof(Header);
+  if(p->s.size*sizeof(Header) > *largest)
+    *largest = p->s.size*sizeof(Header);
+#ifdef BOUNDARY_TAGS
+  if(p + p->s.size == fencep)
+#else
+  if(p + p->s.size == CORE_TOP)
+#endif
+    *top = p->s.size*sizeof(Header);
+}
+
+/* freeStats
+ *
+ * freeStats returns the number of blocks on the free lists and sets
+ * *bytes to their total size, *largest to the size of the biggest and
+ * *top to the size of the one ending the heap (0 if the heap ends
+ * in use). Walking the lists here keeps malloc and free from having
+ * to count. The arena lock must be held with THREADS.
+ *
+ * @param    size_t * bytes
+ * @param    size_t * largest
+ * @param    size_t * top
+ */
+static size_t freeStats(size_t *bytes, size_t *largest, size_t *top)
+{
+  Header *p;
+  size_t n = 0;
+#ifdef USE_BINS
+  unsigned i;
+#endif
+
+  *bytes = *largest = *top = 0;
+#ifdef USE_BINS
+  for(i = 0; i < NBINS; i++)
+    for(p = bins[i]; p != NULL; p = p->s.ptr, n++)
+      countFree(p, bytes, largest, top);
+#if TREE_MIN > 0
+  for(p = treeNext(NULL); p != NULL; p = treeNext(p), n++)
+    countFree(p, bytes, largest, top);
+#endif
+#else
+  if(freep != NULL)
+    for(p = base.s.ptr; p != &base; p = p->s.ptr, n++)
+      countFree(p, bytes, largest, top);
+#endif
+  return n;
+}
+
+/* mallinfo2
+ *
+ * mallinfo2 returns the state of the allocator in the fields glibc
+ * uses: arena is the heap size, ordblks and fordblks count the free
+ * blocks and bytes (those in thread caches included, which smblks and
+ * fsmblks count on their own), uordblks the heap bytes in use, hblks
+ * and hblkhd the blocks with mappings of their own and their size,
+ * and keepcost the free bytes at the top of the heap.
+ */
+struct mallinfo2 mallinfo2(void)
+{
+  struct mallinfo2 mi;
+  struct threadStats sum;
+  size_t largest;
+
+  memset(&mi, 0, sizeof(mi));
+#ifdef THREADS
+  lockArena();
+#endif
+#if DEFER_FREE > 0
+  consolidate();                                        /* as glibc does with its fastbins */
+#endif
+  sumStats(&sum);
+  mi.ordblks = freeStats(&mi.fordblks, &largest, &mi.keepcost);
+  mi.arena = arenaStats.heapBytes + arenaStats.slabBytes;
+#ifdef THREADS
+  unlockArena();
+#endif
+  mi.smblks = sum.cachedBlocks;
+  mi.fsmblks = sum.cachedBytes;
+  mi.ordblks += mi.smblks;
+  mi.fordblks += mi.fsmblks;
+  mi.uordblks = mi.arena - mi.fordblks;
+  mi.hblks = sum.maps - sum.unmaps;
+  mi.hblkhd = sum.mappedBytes;
+  return mi;
+}
+
+/* malloc_stats
+ *
+ * malloc_stats returns nothing, it prints the counters to stderr:
+ * heap, free and mapped bytes, how fragmented the free memory is
+ * (the share not in the largest free block), the searches made by
+ * the strategy in use, the joins made by free and a histogram of
+ * request sizes.
+ */
+void malloc_stats(void)
+{
+  static const char *names[] = { "?", "First Fit", "Best Fit", "Worst Fit", "Segregated Fit", "Next Fit" };
+  struct threadStats sum;
+  size_t nfree, freeBytes, largest, top, heap, slabs;
+  unsigned long morecores, searches, examined, coalesces;
+#if DEFER_FREE > 0
+  unsigned long quickHits, consolidations;
+#endif
+  unsigned i;
+
+#ifdef THREADS
+  lockArena();
+#endif
+#if DEFER_FREE > 0
+  consolidate();
+  quickHits = arenaStats.quickHits;
+  consolidations = arenaStats.consolidations;
+#endif
+  sumStats(&sum);
+  nfree = freeStats(&freeBytes, &largest, &top);
+  heap = arenaStats.heapBytes;
+  slabs = arenaStats.slabBytes;
+  morecores = arenaStats.morecores;
+  searches = arenaStats.searches;
+  examined = arenaStats.examined;
+  coalesces = arenaStats.coalesces;
+#ifdef THREADS
+  unlockArena();
+#endif
+
+  fprintf(stderr, "heap            %zu bytes from %lu morecore calls\n", heap, morecores);
+  fprintf(stderr, "in use          %zu bytes\n", heap + slabs - freeBytes - sum.cachedBytes);
+  fprintf(stderr, "slabs           %zu bytes\n", slabs);
+  fprintf(stderr, "free            %zu bytes in %zu blocks, largest %zu, top %zu\n",
+          freeBytes, nfree, largest, top);
+  fprintf(stderr, "fragmentation   %.1f%%\n", freeBytes ? 100.0*(freeBytes - largest)/freeBytes : 0.0);
+#ifdef THREADS
+  fprintf(stderr, "thread caches   %zu bytes in %zu blocks\n", sum.cachedBytes, sum.cachedBlocks);
+#endif
+  fprintf(stderr, "mapped          %zu bytes in %lu blocks\n", sum.mappedBytes, sum.maps - sum.unmaps);
+  fprintf(stderr, "malloc          %lu calls, %lu mapped", sum.mallocs, sum.maps);
+#ifdef THREADS
+  fprintf(stderr, ", %lu from thread caches", sum.cacheHits);
+#endif
+  fprintf(stderr, "\nfree            %lu calls, %lu joins with a free neighbour\n", sum.frees, coalesces);
+#if DEFER_FREE > 0
+  fprintf(stderr, "deferred free   %lu mallocs from quick lists, %lu consolidations\n", quickHits, consolidations);
+#endif
+#if STRATEGY == 0
+  fprintf(stderr, "%-15s %lu searches", names[strategy], searches);
+#else
+  fprintf(stderr, "%-15s %lu searches", names[STRATEGY], searches);
+#endif
+  fprintf(stderr, ", %.1f blocks examined per search\n", searches ? (double) examined/searches : 0.0);
+  fprintf(stderr, "request sizes\n");
+  for(i = 0; i < NSIZES; i++)
+    if(sum.sizes[i] != 0) {
+      if(i < NSIZES-1)
+        fprintf(stderr, "  <= %-10zu  %lu\n", (size_t) 16 << i, sum.sizes[i]);
+      else
+        fprintf(stderr, "   > %-10zu  %lu\n", (size_t) 16 << (i-1), sum.sizes[i]);
+    }
+}
+
+/* statsAtExit
+ *
+ * statsAtExit returns nothing, it calls malloc_stats as the process
+ * exits if the environment variable MALLOC_STATS is set and not 0.
+ */
+__attribute__((destructor))
+static void statsAtExit(void)
+{
+  char *env = getenv("MALLOC_STATS");
+
+  if(env != NULL && *env != '\0' && strcmp(env, "0") != 0)
+    malloc_stats();
+}
+
+/* Heap maps
+ *
+ * A snapshot of the heap is an array of words: for every region its
+ * start, end and number of runs, then the runs, a block in use (or
+ * several next to each other) as units << 1 and a free block as
+ * units << 1 | 1. Only taking it holds the arena lock, a read of every
+ * header, and the sums and output are made from the copy, so a live
+ * process is not held up for long. Blocks in thread caches count as
+ * in use, slabs and mapped blocks are not part of the heap.
+ */
+#define WALKED 8                                        /* a free block, while heapSnapshot runs */
+
+#ifndef BOUNDARY_TAGS
+/* markFree
+ *
+ * markFree returns nothing, it sets WALKED on every block on the free
+ * lists, which have no flag of their own to tell them by without
+ * boundary tags. heapSnapshot clears it again.
+ */
+static void markFree(void)
+{
+  Header *p;
+#ifdef USE_BINS
+  unsigned i;
+
+  for(i = 0; i < NBINS; i++)
+    for(p = bins[i]; p != NULL; p = p->s.ptr)
+      p->s.flags |= WALKED;
+#if TREE_MIN > 0
+  for(p = treeNext(NULL); p != NULL; p = treeNext(p))
+    p->s.flags |= WALKED;
+#endif
+#else
+  if(freep != NULL)
+    for(p = base.s.ptr; p != &base; p = p->s.ptr)
+      p->s.flags |= WALKED;
+#endif
+}
+#endif
+
+/* heapSnapshot
+ *
+ * heapSnapshot returns a snapshot of the heap in a mapping of *len
+ * bytes holding *words words, or NULL if it cannot be mapped.
+ *
+ * @param    size_t * words
+ * @param    size_t * len
+ */
+static size_t *heapSnapshot(size_t *words, size_t *len)
+{
+  size_t *map, *runs, n = 0, max, i;
+  Header *p, *end;
+  int isFree;
+
+#ifdef THREADS
+  lockArena();
+#endif
+#if DEFER_FREE > 0
+  consolidate();                                        /* blocks held back would look in use */
+#endif
+  max = 3*nregions + arenaStats.heapBytes/sizeof(Header);
+  *len = (size_t) PAGE_UP((max + 1)*sizeof(size_t));    /* only the pages written are committed */
+  map = mmap(NULL, *len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if(map != MAP_FAILED) {
+#ifndef BOUNDARY_TAGS
+    markFree();
+#endif
+    for(i = 0; i < nregions && n + 3 <= max; i++) {
+      map[n++] = (size_t) regions[i].start;
+      map[n++] = (size_t) regions[i].end;
+      runs = &map[n++];
+      *runs = 0;
+      end = (Header *)(regions[i].end - HDR);
+      for(p = (Header *)(regions[i].start + HDR); p < end && p->s.size > 0; p += p->s.size) {
+#ifdef BOUNDARY_TAGS
+        isFree = p->s.flags & BT_FREE;
+#else
+        isFree = (p->s.flags & WALKED) != 0;
+        p->s.flags &= ~WALKED;
+#endif
+        if(!isFree && *runs > 0 && !(map[n-1] & 1))
+          map[n-1] += p->s.size << 1;                   /* next to the block in use before it */
+        else if(n < max) {
+          map[n++] = p->s.size << 1 | isFree;
+          (*runs)++;
+        }
+      }
+    }
+  }
+#ifdef THREADS
+  unlockArena();
+#endif
+  *words = n;
+  return map != MAP_FAILED ? map : NULL;
+}
+
+/* regionInfo
+ *
+ * regionInfo returns nothing, it adds the runs of the region at map,
+ * in a snapshot, to the sums in *hi.
+ *
+ * @param    size_t * map
+ * @param    struct malloc_heapinfo * hi
+ */
+static void regionInfo(size_t *map, struct malloc_heapinfo *hi)
+{
+  size_t i, bytes;
+
+  hi->regions++;
+  hi->heap += map[1] - map[0];
+  for(i = 0; i < map[2]; i++) {
+    bytes = (map[3+i] >> 1)*sizeof(Header);
+    if(map[3+i] & 1) {
+      hi->free += bytes;
+      hi->freeBlocks++;
+      if(bytes > hi->largestFree)
+        hi->largestFree = bytes;
+      hi->histogram[sizeClass(bytes)]++;
+    }
+    else
+      hi->used += bytes;
+  }
+  hi->fragmentation = hi->free ? (double)(hi->free - hi->largestFree)/hi->free : 0.0;
+}
+
+/* malloc_heapinfo
+ *
+ * malloc_heapinfo returns 0 and fills in *hi from a walk of the heap
+ * regions morecore got, see malloc.h, or -1 if there is no memory
+ * for the snapshot.
+ *
+ * @param    struct malloc_heapinfo * hi
+ */
+int malloc_heapinfo(struct malloc_heapinfo *hi)
+{
+  size_t *map, words, len, i;
+
+  memset(hi, 0, sizeof(*hi));
+  if((map = heapSnapshot(&words, &len)) == NULL)
+    return -1;
+  for(i = 0; i < words; i += 3 + map[i+2])
+    regionInfo(&map[i], hi);
+  munmap(map, len);
+  return 0;
+}
+
+struct mapOut {                                         /* written without stdio, which may malloc */
+  int fd, failed;
+  size_t n;
+  char buf[4096];
+};
+
+static void mapFlush(struct mapOut *out)
+{
+  if(out->n > 0 && write(out->fd, out->buf, out->n) != (ssize_t) out->n)
+    out->failed = 1;
+  out->n = 0;
+}
+
+static void mapPut(struct mapOut *out, const char *fmt, ...)
+{
+  va_list ap;
+
+  if(out->n > sizeof(out->buf) - 128)                   /* room for the longest line but the runs */
+    mapFlush(out);
+  va_start(ap, fmt);
+  out->n += vsnprintf(out->buf + out->n, sizeof(out->buf) - out->n, fmt, ap);
+  va_end(ap);
+}
+
+/* malloc_heapmap
+ *
+ * malloc_heapmap returns 0 after writing a map of the heap to fd, or
+ * -1 if it could not be made or written. It is text, a first line
+ *
+ *    heapmap unit_bytes regions
+ *
+ * then for every region a line
+ *
+ *    region start bytes used free free_blocks largest_free
+ *
+ * followed by a line of its runs in units, blocks in use (next to
+ * each other counted together) as n and free blocks as -n. The fields
+ * are separated by tabs, the runs by spaces. heapview.c reads it.
+ *
+ * @param    int fd
+ */
+int malloc_heapmap(int fd)
+{
+  struct mapOut out;
+  struct malloc_heapinfo hi;
+  size_t *map, words, len, i, j, nregions = 0;
+
+  if((map = heapSnapshot(&words, &len)) == NULL)
+    return -1;
+  for(i = 0; i < words; i += 3 + map[i+2])
+    nregions++;
+  out.fd = fd;
+  out.failed = 0;
+  out.n = 0;
+  mapPut(&out, "heapmap\t%zu\t%zu\n", sizeof(Header), nregions);
+  for(i = 0; i < words; i += 3 + map[i+2]) {
+    memset(&hi, 0, sizeof(hi));
+    regionInfo(&map[i], &hi);
+    mapPut(&out, "region\t%#zx\t%zu\t%zu\t%zu\t%zu\t%zu\n", map[i], map[i+1] - map[i],
+           hi.used, hi.free, hi.freeBlocks, hi.largestFree);
+    for(j = 0; j < map[i+2]; j++)
+      mapPut(&out, j > 0 ? " %s%zu" : "%s%zu", map[i+3+j] & 1 ? "-" : "", map[i+3+j] >> 1);
+    mapPut(&out, "\n");
+  }
+  mapFlush(&out);
+  munmap(map, len);
+  return out.failed ? -1 : 0;
+}
+
+/* heapMapSignal, heapMapOpen
+ *
+ * With MALLOC_HEAPMAP set in the environment, SIGUSR2 asks for a map
+ * of the heap of a running process. The handler only sets a flag,
+ * the next call to malloc or free (in any thread) writes the map to
+ * the file named by MALLOC_HEAPMAP with the pid and a count added,
+ * e.g. 'kill -USR2 1234' gives heap.1234.0 with MALLOC_HEAPMAP=heap.
+ */
+static const char *heapMapName = NULL;
+
+static void heapMapSignal(int sig)
+{
+  heapMapWanted = 1;
+}
+
+__attribute__((constructor))
+static void heapMapOpen(void)
+{
+  struct sigaction sa;
+
+  heapMapName = getenv("MALLOC_HEAPMAP");
+  if(heapMapName == NULL || *heapMapName == '\0')
+    return;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = heapMapSignal;
+  sa.sa_flags = SA_RESTART;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGUSR2, &sa, NULL);
+}
+
+/* heapMapDump
+ *
+ * heapMapDump returns nothing, it writes the map SIGUSR2 asked for.
+ */
+static void heapMapDump(void)
+{
+  static unsigned long count = 0;
+  char name[4096];
+  int fd;
+
+  heapMapWanted = 0;
+  snprintf(name, sizeof(name), "%s.%d.%lu", heapMapName, (int) getpid(), count++);
+  if((fd = open(name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)) < 0)
+    return;
+  malloc_heapmap(fd);
+  close(fd);
+}
+#else
+/* mallinfo2, malloc_stats
+ *
+ * Without STATS there are no counters to report, but both are still
+ * defined so callers do not get the libc ones, which describe the
+ * libc heap. mallinfo2 returns all zeroes and malloc_stats says so.
+ */
+struct mallinfo2 mallinfo2(void)
+{
+  struct mallinfo2 mi;
+
+  memset(&mi, 0, sizeof(mi));
+  return mi;
+}
+
+void malloc_stats(void)
+{
+  fprintf(stderr, "malloc statistics are compiled out (STATS=0)\n");
+}
+
+/* malloc_heapinfo, malloc_heapmap
+ *
+ * The heap walks need the region table, which goes with the counters.
+ * Without it both return -1 with errno set to ENOSYS.
+ */
+int malloc_heapinfo(struct malloc_heapinfo *hi)
+{
+  memset(hi, 0, sizeof(*hi));
+  errno = ENOSYS;
+  return -1;
+}
+
+int malloc_heapmap(int fd)
+{
+  errno = ENOSYS;
+  return -1;
+}
+#endif
@@ -1,7 +1,59 @@
 #ifndef __MALLOC_H__
 #define __MALLOC_H__
 
+struct pool;                            /* see pool_create in malloc.c */
+struct arena;                           /* see arena_create in malloc.c */
+
+struct arena_mark {                     /* see arena_save in malloc.c */
+  void *chunk;
+  char *next;
+};
+
+struct mallinfo2 {                      /* see mallinfo2 in malloc.c */
+  size_t arena;
+  size_t ordblks;
+  size_t smblks;
+  size_t hblks;
+  size_t hblkhd;
+  size_t usmblks;
+  size_t fsmblks;
+  size_t uordblks;
+  size_t fordblks;
+  size_t keepcost;
+};
+
+struct malloc_heapinfo {                /* see malloc_heapinfo in malloc.c */
+  size_t regions;                       /* got by morecore in one piece */
+  size_t heap;                          /* bytes in them */
+  size_t used, free;                    /* bytes in blocks in use and in free blocks */
+  size_t freeBlocks, largestFree;
+  double fragmentation;                 /* share of free bytes not in the largest free block */
+  size_t histogram[24];                 /* free blocks of at most 16 << i bytes, the last also more */
+};
+
 extern void *malloc(size_t);
 extern void free(void *);
 extern void *realloc(void *, size_t);
+extern void *calloc(size_t, size_t);
+extern int posix_memalign(void **, size_t, size_t);
+extern void *aligned_alloc(size_t, size_t);
+extern void *memalign(size_t, size_t);
+extern void *valloc(size_t);
+extern void *pvalloc(size_t);
+extern size_t malloc_usable_size(void *);
+extern int malloc_trim(size_t);
+extern struct pool *pool_create(size_t);
+extern void *pool_alloc(struct pool *);
+extern void pool_free(struct pool *, void *);
+extern void pool_destroy(struct pool *);
+extern struct arena *arena_create(size_t);
+extern void *arena_alloc(struct arena *, size_t);
+extern struct arena_mark arena_save(struct arena *);
+extern void arena_restore(struct arena *, struct arena_mark);
+extern void arena_reset(struct arena *);
+extern void arena_destroy(struct arena *);
+extern struct mallinfo2 mallinfo2(void);
+extern void malloc_stats(void);
+extern int malloc_heapinfo(struct malloc_heapinfo *);
+extern int malloc_heapmap(int);
 #endif
@@ -0,0 +1,23 @@
+#!/bin/bash
+
+# Counts the mmap calls made by morecore for the tstmalloc.c workload,
+# once mapping every chunk on its own and once reserving address space
+# and committing it in growing chunks (the default).
+
+WRAP=-Wl,--wrap=mmap,--wrap=mprotect,--wrap=munmap,--wrap=madvise
+LIMIT=100
+
+for RESERVE in 0 "64*1024*1024"
+do
+   gcc -O2 -DMMAP_RESERVE="$RESERVE" -o tstMmap malloc.c tstmalloc.c tstSyscalls.c $WRAP || exit 1
+   echo "MMAP_RESERVE=$RESERVE"
+   ./tstMmap
+   TIME=$(date +%s%N)
+   for (( c=1; c<=$LIMIT; c++ ))
+   do
+      ./tstMmap 2> /dev/null
+   done
+   TIME=$(($(date +%s%N)-TIME))
+   echo "average $((TIME/LIMIT)) ns per run"
+done
+rm -f tstMmap
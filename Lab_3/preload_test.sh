@@ -0,0 +1,14 @@
+#!/bin/bash
+
+# Builds malloc.c as a shared library and runs some ordinary programs
+# with it preloaded in place of the libc allocator.
+
+gcc -O2 -shared -fPIC -DTHREADS -o libmalloc.so malloc.c -lpthread || exit 1
+
+for CMD in "ls -lR /usr/include" "sort /etc/services" \
+           "python3 -c 'import json; json.dumps(list(range(100000)))'"
+do
+   LD_PRELOAD=$PWD/libmalloc.so bash -c "$CMD" > /dev/null
+   echo "$? $CMD"
+done
+rm -f libmalloc.so
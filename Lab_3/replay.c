@@ -0,0 +1,230 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include "malloc.h"
+#include "trace.h"
+
+/* Replays a trace recorded by malloc.c built with -DTRACE, e.g.
+ *
+ *    gcc -O2 -shared -fPIC -DTHREADS -DTRACE -o libmalloc.so malloc.c -lpthread
+ *    MALLOC_TRACE=ls.trace LD_PRELOAD=./libmalloc.so ls -lR /usr
+ *
+ * which writes ls.trace.<pid>, one file per traced process, against
+ * the allocator it is built with: 'gcc -O2 malloc.c replay.c' (with
+ * -DSTRATEGY=0 MALLOC_STRATEGY picks the strategy at run time), or
+ * replay.c alone for the libc malloc. Run './replay ls.trace.<pid> [label]'.
+ * The calls are made in the order of the trace from a single thread.
+ * One tab separated line is printed:
+ *
+ *    label ops time_ms peak_rss_kb base_rss_kb peak_heap peak_live fragmentation unmatched
+ *
+ * time_ms is spent in the allocator only, base_rss_kb is what the
+ * replay itself holds before the first call. peak_heap is the most
+ * heap and mapped memory held at once as mallinfo2 sees it, every
+ * SAMPLE calls, with peak_live bytes asked for and not freed at that
+ * point, fragmentation being the rest of it in percent. unmatched
+ * counts frees of blocks the trace never saw being allocated, like
+ * those made before tracing started.
+ */
+
+#define SAMPLE 1024                                     /* calls between looks at mallinfo2 */
+
+struct entry {                                          /* traced address -> our block */
+  unsigned long key;
+  char *block;
+  size_t size;
+};
+
+static struct entry *table;
+static size_t mask;                                     /* table size - 1, a power of two */
+static size_t live = 0;                                 /* bytes asked for and not freed */
+
+static void * mapArray(size_t bytes){
+  void *p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+  if(p == MAP_FAILED){
+    perror("replay");
+    exit(1);
+  }
+  return p;
+}
+
+static size_t slot(unsigned long key){
+  size_t i = (key >> 4) * 0x9e3779b97f4a7c15UL & mask;
+
+  while(table[i].key != 0 && table[i].key != key)
+    i = (i+1) & mask;
+  return i;
+}
+
+/* Removes the entry at i, moving back those that probed past it. */
+static void removeSlot(size_t i){
+  size_t j = i, k;
+
+  for(;;){
+    table[i].key = 0;
+    do {
+      j = (j+1) & mask;
+      if(table[j].key == 0)
+        return;
+      k = (table[j].key >> 4) * 0x9e3779b97f4a7c15UL & mask;
+    } while(i <= j ? i < k && k <= j : i < k || k <= j);
+    table[i] = table[j];
+    i = j;
+  }
+}
+
+static void enter(unsigned long key, char *block, size_t size, unsigned long *unmatched){
+  size_t i;
+
+  if(key == 0 || block == NULL)
+    return;
+  i = slot(key);
+  if(table[i].key != 0){                                /* its free is later in the trace */
+    live -= table[i].size;
+    free(table[i].block);
+    (*unmatched)++;
+  }
+  table[i].key = key;
+  table[i].block = block;
+  table[i].size = size;
+  live += size;
+  block[0] = block[size > 0 ? size-1 : 0] = 1;
+}
+
+/* Returns our block for key and forgets it, or NULL if unknown. */
+static char * leave(unsigned long key){
+  size_t i = slot(key);
+  char *block = table[i].block;
+
+  if(table[i].key == 0)
+    return NULL;
+  live -= table[i].size;
+  removeSlot(i);
+  return block;
+}
+
+static int bySeq(const void *a, const void *b){
+  const struct traceRecord *x = a, *y = b;
+
+  return x->seq < y->seq ? -1 : x->seq > y->seq;
+}
+
+static long long now(void){
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec*1000000000LL + ts.tv_nsec;
+}
+
+static long rssKb(void){
+  struct rusage ru;
+
+  getrusage(RUSAGE_SELF, &ru);
+  return ru.ru_maxrss;
+}
+
+int main(int argc, char *argv[]){
+  struct traceRecord *trace, *r;
+  struct mallinfo2 mi;
+  struct stat st;
+  size_t n, i, size, heap, peakHeap = 0, peakLive = 0;
+  unsigned long unmatched = 0;
+  long long t, total = 0;
+  long baseRss;
+  ssize_t got;
+  char *block, *p;
+  int fd;
+
+  if(argc < 2){
+    fprintf(stderr, "usage: %s trace [label]\n", argv[0]);
+    return 2;
+  }
+  if((fd = open(argv[1], O_RDONLY)) < 0 || fstat(fd, &st) < 0){
+    perror(argv[1]);
+    return 1;
+  }
+  n = st.st_size/sizeof(struct traceRecord);
+  trace = mapArray(n*sizeof(struct traceRecord) + 1);
+  for(i = 0; i < n*sizeof(struct traceRecord); i += got)
+    if((got = read(fd, (char *) trace + i, n*sizeof(struct traceRecord) - i)) <= 0){
+      perror(argv[1]);
+      return 1;
+    }
+  close(fd);
+  for(i = 1; i < n && trace[i-1].seq < trace[i].seq; i++)
+    ;
+  if(i < n)                                             /* threads flushed out of order */
+    qsort(trace, n, sizeof(struct traceRecord), bySeq);
+  for(mask = 1; mask < 2*n; mask <<= 1)
+    ;
+  table = mapArray(mask*sizeof(struct entry));
+  memset(table, 0, mask*sizeof(struct entry));
+  mask--;
+  baseRss = rssKb();
+
+  for(i = 0; i < n; i++){
+    r = &trace[i];
+    size = TRACE_SIZE(r);
+    if(i % SAMPLE == 0){
+      mi = mallinfo2();
+      heap = mi.arena + mi.hblkhd;
+      if(heap > peakHeap){
+        peakHeap = heap;
+        peakLive = live;
+      }
+    }
+    switch(TRACE_OP(r)){
+    case TRACE_MALLOC:
+      t = now();
+      block = malloc(size);
+      total += now() - t;
+      enter(r->result, block, size, &unmatched);
+      break;
+    case TRACE_CALLOC:
+      t = now();
+      block = calloc(size, 1);
+      total += now() - t;
+      enter(r->result, block, size, &unmatched);
+      break;
+    case TRACE_MEMALIGN:
+      t = now();
+      block = memalign(r->ptr, size);
+      total += now() - t;
+      enter(r->result, block, size, &unmatched);
+      break;
+    case TRACE_FREE:
+      if((block = leave(r->ptr)) == NULL){
+        unmatched++;
+        break;
+      }
+      t = now();
+      free(block);
+      total += now() - t;
+      break;
+    case TRACE_REALLOC:
+      block = r->ptr != 0 ? leave(r->ptr) : NULL;
+      if(r->ptr != 0 && block == NULL)
+        unmatched++;
+      t = now();
+      p = realloc(block, size);
+      total += now() - t;
+      if(p == NULL && size > 0)                         /* failed, drop the old block too */
+        free(block);
+      else
+        enter(r->result, p, size, &unmatched);
+      break;
+    }
+  }
+
+  printf("%s\t%zu\t%.1f\t%ld\t%ld\t%zu\t%zu\t%.1f\t%lu\n", argc > 2 ? argv[2] : "replay",
+         n, total/1e6, rssKb(), baseRss, peakHeap, peakLive,
+         peakHeap ? 100.0*(peakHeap - peakLive)/peakHeap : 0.0, unmatched);
+  return 0;
+}
@@ -0,0 +1,23 @@
+#ifndef _trace_h_
+#define _trace_h_
+
+/* A trace, as written by malloc.c built with -DTRACE, is a sequence
+ * of these records in the byte order of the machine that wrote it. */
+
+#define TRACE_MALLOC   0
+#define TRACE_FREE     1
+#define TRACE_REALLOC  2
+#define TRACE_CALLOC   3
+#define TRACE_MEMALIGN 4
+
+struct traceRecord {
+  unsigned long seq;                                    /* order of the call among all threads */
+  unsigned long size;                                   /* the op in the top 8 bits, bytes below */
+  unsigned long ptr;                                    /* argument of free and realloc, alignment of memalign */
+  unsigned long result;                                 /* returned by malloc, realloc, calloc and memalign */
+};
+
+#define TRACE_OP(r)   ((r)->size >> 56)
+#define TRACE_SIZE(r) ((r)->size & ((1UL << 56) - 1))
+
+#endif
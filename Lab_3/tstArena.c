@@ -0,0 +1,50 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "malloc.h"
+
+/* Build with 'gcc malloc.c tstArena.c'. */
+
+#define TIMES 10000
+
+int main(int argc, char *argv[]){
+  struct arena *arena;
+  struct arena_mark mark;
+  char *array[TIMES], *big;
+  int i, failed = 0;
+
+  if((arena = arena_create(0)) == NULL){
+    fprintf(stderr,"arena_create failed\n");
+    return 1;
+  }
+  for(i=0;i<TIMES;i++){
+    array[i] = arena_alloc(arena, 1 + i%300);
+    if(array[i] == NULL || (unsigned long)array[i] % 16 != 0){
+      fprintf(stderr,"arena_alloc failed at %d\n",i);
+      return 1;
+    }
+    memset(array[i], i, 1 + i%300);
+  }
+
+  /* What is taken after a mark is gone after restoring it, even over new chunks. */
+  mark = arena_save(arena);
+  big = arena_alloc(arena, 1000000);
+  memset(big, 0, 1000000);
+  for(i=0;i<TIMES;i++)
+    memset(arena_alloc(arena, 100), 0, 100);
+  arena_restore(arena, mark);
+  if(arena_alloc(arena, 1) != mark.next)
+    failed = 1;
+  for(i=0;i<TIMES;i++)
+    if(array[i][0] != (char)i || array[i][i%300] != (char)i)
+      failed = 1;
+
+  arena_reset(arena);
+  for(i=0;i<TIMES;i++)
+    memset(arena_alloc(arena, 1 + i%300), 0, 1 + i%300);
+  arena_destroy(arena);
+
+  if(failed)
+    fprintf(stderr,"arena objects were overwritten\n");
+  return failed;
+}
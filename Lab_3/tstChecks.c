@@ -0,0 +1,87 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+/* Build with 'gcc -DCHECKS=7 malloc.c tstChecks.c'. Every bad call is
+ * made in a child of its own, which the checks have to abort. */
+
+static char *volatile p, *volatile q;                  /* so the compiler keeps every call */
+static char outside[64];
+
+static void doubleFreeSmall(void){ p = malloc(40); free(p); free(p); }
+static void doubleFreeBlock(void){ p = malloc(1000); free(p); free(p); }
+static void doubleFreeJoined(void){ p = malloc(1000); q = malloc(1000); free(p); free(q); free(q); }
+static void freeOutside(void){ p = outside + 16; free(p); }
+static void freeInside(void){ p = malloc(1000); q = p + 256; free(q); }
+static void freeMisaligned(void){ p = malloc(1000); q = p + 8; free(q); }
+static void reallocFreed(void){ p = malloc(1000); free(p); p = realloc(p, 2000); }
+static void badHeader(void){ p = malloc(1000); memset(p - 8, 0x41, 8); free(p); }
+static void freeUnmapped(void){
+  p = mmap(NULL, 4096, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  munmap(p, 4096);
+  q = p + 16;
+  free(q);
+}
+static void freeFakeMapped(void){ memset(outside, 0xff, 16); p = outside + 16; free(p); }
+
+static struct { const char *name; void (*bad)(void); } cases[] = {
+  { "double free of a slab object", doubleFreeSmall },
+  { "double free of a block", doubleFreeBlock },
+  { "double free of a joined block", doubleFreeJoined },
+  { "free of an address outside the heap", freeOutside },
+  { "free inside a block", freeInside },
+  { "free of a misaligned pointer", freeMisaligned },
+  { "realloc of a freed block", reallocFreed },
+  { "free with an overwritten header", badHeader },
+  { "free of an address on an unmapped page", freeUnmapped },
+  { "free of an address outside the heap that looks mapped", freeFakeMapped },
+};
+
+int main(int argc, char *argv[]){
+  unsigned i;
+  int status, failed = 0;
+  pid_t pid;
+
+  for(i = 0; i < sizeof(cases)/sizeof(cases[0]); i++){
+    if((pid = fork()) == 0){
+      close(2);                                         /* the report is expected */
+      cases[i].bad();
+      _exit(0);
+    }
+    waitpid(pid, &status, 0);
+    if(!WIFSIGNALED(status) || WTERMSIG(status) != SIGABRT){
+      fprintf(stderr,"not caught: %s\n", cases[i].name);
+      failed = 1;
+    }
+  }
+
+  /* Freed areas are poisoned beyond the free list links. */
+  p = malloc(1000);
+  memset(p, 0, 1000);
+  free(p);
+  if((unsigned char)p[500] != 0xdf){
+    fprintf(stderr,"freed block was not poisoned\n");
+    failed = 1;
+  }
+
+  /* Blocks handed out again are sealed anew and free as usual. */
+  for(i = 0; i < 1000; i++){
+    p = malloc(1 + i*7);
+    q = realloc(malloc(100), 300 + i);
+    free(p);
+    free(q);
+  }
+  /* And so are blocks with mappings of their own, moved or trimmed. */
+  for(i = 0; i < 100; i++){
+    p = malloc(200000 + i*4096);
+    q = aligned_alloc(65536, 300000);
+    p = realloc(p, 600000 + i*4096);
+    free(q);
+    free(p);
+  }
+  return failed;
+}
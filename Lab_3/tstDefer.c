@@ -0,0 +1,48 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include "malloc.h"
+
+/* Build with 'gcc -DDEFER_FREE=64 malloc.c tstDefer.c', without
+ * THREADS so freed blocks do not stop in thread caches. */
+
+#define TIMES 1000
+
+int main(int argc, char *argv[]){
+  static char *array[TIMES];
+  struct mallinfo2 mi;
+  size_t arena = 0;
+  char *p, *q;
+  int i, round, failed = 0;
+
+  /* A freed block comes back at once for a request of its size. */
+  p = malloc(1000);
+  free(p);
+  if((q = malloc(1000)) != p){
+    fprintf(stderr,"freed block not reused\n");
+    failed = 1;
+  }
+  free(q);
+
+  /* Bursts of frees are joined when consolidated, and the heap stops
+   * growing once the first burst is back. */
+  for(round = 0; round < 4; round++){
+    for(i = 0; i < TIMES; i++)
+      array[i] = malloc(1024 + i%5*100);
+    for(i = 0; i < TIMES; i += 2)
+      free(array[i]);
+    for(i = 1; i < TIMES; i += 2)
+      free(array[i]);
+    mi = mallinfo2();
+    if(mi.ordblks > 2){
+      fprintf(stderr,"round %d: %zu free blocks left apart\n", round, mi.ordblks);
+      failed = 1;
+    }
+    if(round == 1)
+      arena = mi.arena;
+    else if(round > 1 && mi.arena > arena){
+      fprintf(stderr,"round %d: heap grew from %zu to %zu\n", round, arena, mi.arena);
+      failed = 1;
+    }
+  }
+  return failed;
+}
@@ -0,0 +1,46 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "malloc.h"
+
+/* Build with 'gcc malloc.c tstHeapmap.c', without THREADS so no
+ * freed blocks wait in thread caches. */
+
+#define TIMES 10000
+
+int main(int argc, char *argv[]){
+  static char *array[TIMES];
+  struct malloc_heapinfo hi;
+  struct mallinfo2 mi;
+  char map[64];
+  FILE *f;
+  int i, failed = 0;
+
+  for(i=0;i<TIMES;i++)
+    array[i] = malloc(300 + i*37%3000);
+  for(i=0;i<TIMES;i+=3)
+    free(array[i]);
+
+  /* The walk and the free lists agree. */
+  if(malloc_heapinfo(&hi) != 0)
+    return 1;
+  mi = mallinfo2();
+  if(hi.free != mi.fordblks || hi.freeBlocks != mi.ordblks || hi.heap > mi.arena){
+    fprintf(stderr,"heapinfo: %zu free in %zu blocks, mallinfo2: %zu in %zu\n",
+            hi.free, hi.freeBlocks, mi.fordblks, mi.ordblks);
+    failed = 1;
+  }
+  if(hi.regions == 0 || hi.used + hi.free > hi.heap || hi.largestFree > hi.free
+     || hi.fragmentation < 0.0 || hi.fragmentation > 1.0)
+    failed = 1;
+
+  /* The map starts with its header line. */
+  if((f = tmpfile()) == NULL || malloc_heapmap(fileno(f)) != 0)
+    return 1;
+  rewind(f);
+  if(fgets(map, sizeof(map), f) == NULL || strncmp(map, "heapmap\t16\t", 11) != 0){
+    fprintf(stderr,"map starts with '%s'\n", map);
+    failed = 1;
+  }
+  return failed;
+}
@@ -0,0 +1,67 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "malloc.h"
+
+/* Build with 'gcc malloc.c tstPool.c'. */
+
+#define TIMES 10000
+
+struct node {                                           /* a typical small struct */
+  struct node *next;
+  int key;
+  char name[20];
+};
+
+int main(int argc, char *argv[]){
+  struct pool *pool;
+  struct node *array[TIMES];
+  int i, failed = 0;
+
+  if((pool = pool_create(sizeof(struct node))) == NULL){
+    fprintf(stderr,"pool_create failed\n");
+    return 1;
+  }
+  for(i=0;i<TIMES;i++){
+    array[i] = pool_alloc(pool);
+    if(array[i] == NULL || (unsigned long)array[i] % sizeof(void *) != 0){
+      fprintf(stderr,"pool_alloc failed at %d\n",i);
+      return 1;
+    }
+    array[i]->key = i;
+    memset(array[i]->name, i, sizeof(array[i]->name));
+  }
+  /* Objects sit back to back, the pool keeps no header per object. */
+  if((char *)array[1] - (char *)array[0] != sizeof(struct node)){
+    fprintf(stderr,"objects are %ld bytes apart\n",(long)((char *)array[1] - (char *)array[0]));
+    failed = 1;
+  }
+  for(i=0;i<TIMES;i+=2)
+    pool_free(pool, array[i]);
+  for(i=0;i<TIMES;i+=2)
+    array[i] = pool_alloc(pool);
+  for(i=1;i<TIMES;i+=2)
+    if(array[i]->key != i || array[i]->name[19] != (char)i)
+      failed = 1;
+  pool_destroy(pool);
+
+  /* Small mallocs come from slabs as well. */
+  for(i=0;i<TIMES;i++){
+    array[i] = malloc(1 + i%256);
+    memset(array[i], i, 1 + i%256);
+  }
+  for(i=0;i<TIMES;i++)
+    if(malloc_usable_size(array[i]) < 1 + i%256 || ((char *)array[i])[i%256] != (char)i)
+      failed = 1;
+  for(i=0;i<TIMES;i++)
+    array[i] = realloc(array[i], 300);
+  for(i=0;i<TIMES;i++)
+    if(((char *)array[i])[i%256] != (char)i)
+      failed = 1;
+  for(i=0;i<TIMES;i++)
+    free(array[i]);
+
+  if(failed)
+    fprintf(stderr,"pool objects were overwritten\n");
+  return failed;
+}
@@ -0,0 +1,40 @@
+#include <stdio.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+/*
+ * Counts the memory system calls made by malloc.c. Link it in with
+ * 'gcc malloc.c tstmalloc.c tstSyscalls.c -Wl,--wrap=mmap,--wrap=mprotect,--wrap=munmap,--wrap=madvise'
+ * and the totals are printed to stderr when the program exits.
+ */
+
+static long mmaps, mprotects, munmaps, madvises;
+
+void *__real_mmap(void *, size_t, int, int, int, off_t);
+int __real_mprotect(void *, size_t, int);
+int __real_munmap(void *, size_t);
+int __real_madvise(void *, size_t, int);
+
+void *__wrap_mmap(void *addr, size_t len, int prot, int flags, int fd, off_t off){
+  mmaps++;
+  return __real_mmap(addr, len, prot, flags, fd, off);
+}
+
+int __wrap_mprotect(void *addr, size_t len, int prot){
+  mprotects++;
+  return __real_mprotect(addr, len, prot);
+}
+
+int __wrap_munmap(void *addr, size_t len){
+  munmaps++;
+  return __real_munmap(addr, len);
+}
+
+int __wrap_madvise(void *addr, size_t len, int advice){
+  madvises++;
+  return __real_madvise(addr, len, advice);
+}
+
+static void __attribute__((destructor)) report(void){
+  fprintf(stderr, "mmap %ld mprotect %ld munmap %ld madvise %ld\n", mmaps, mprotects, munmaps, madvises);
+}
@@ -0,0 +1,105 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include "malloc.h"
+
+/* Build with 'gcc -DTHREADS malloc.c tstThreadMalloc.c -lpthread'. */
+
+#define NTHREADS 8
+#define ROUNDS 200
+#define TIMES 1000
+#define LATE 5000                                       /* threads freeing after the cache is flushed */
+
+static char *handoff[NTHREADS][TIMES];                 /* blocks freed by the next thread */
+static pthread_mutex_t handoffLock[NTHREADS];
+
+static void * worker(void *arg){
+  int id = (int)(long)arg;
+  int next = (id+1)%NTHREADS;
+  int i, r, failed = 0;
+  size_t size;
+  char *array[TIMES];
+
+  for(r=0;r<ROUNDS;r++){
+    for(i=0;i<TIMES;i++){
+      size = 1 + (i*37 + r*11 + id)%2048;
+      array[i] = malloc(size);
+      if(array[i] == NULL){
+        fprintf(stderr,"thread %d: malloc(%zu) returned NULL\n",id,(size_t)size);
+        return (void *)1;
+      }
+      memset(array[i], id, size);
+    }
+    for(i=0;i<TIMES;i++){
+      size = 1 + (i*37 + r*11 + id)%2048;
+      if(array[i][0] != id || array[i][size-1] != id)
+        failed = 1;
+    }
+
+    /* Every other block is freed by the next thread. */
+    pthread_mutex_lock(&handoffLock[next]);
+    for(i=0;i<TIMES;i+=2){
+      free(handoff[next][i]);
+      handoff[next][i] = array[i];
+    }
+    pthread_mutex_unlock(&handoffLock[next]);
+    for(i=1;i<TIMES;i+=2)
+      free(array[i]);
+  }
+  if(failed)
+    fprintf(stderr,"thread %d: block overwritten by another thread\n",id);
+  return (void *)(long)failed;
+}
+
+/* Run by pthreads at thread exit, possibly after the destructor that
+ * flushes the thread cache. */
+static pthread_key_t lateKey;
+static char *volatile late;
+
+static void lateFree(void *arg){
+  late = malloc(400);
+  free(late);
+  late = malloc(40);
+  free(late);
+}
+
+static void * lateWorker(void *arg){
+  late = malloc(100);
+  free(late);
+  pthread_setspecific(lateKey, (void *)1);
+  return NULL;
+}
+
+int main(int argc, char *argv[]){
+  int i, j, failed = 0;
+  size_t arena;
+  void *result;
+  pthread_t tid[NTHREADS];
+
+  for(i=0;i<NTHREADS;i++)
+    pthread_mutex_init(&handoffLock[i], NULL);
+  for(i=0;i<NTHREADS;i++)
+    pthread_create(&tid[i], NULL, worker, (void *)(long)i);
+  for(i=0;i<NTHREADS;i++){
+    pthread_join(tid[i], &result);
+    failed |= result != NULL;
+  }
+  for(i=0;i<NTHREADS;i++)
+    for(j=0;j<TIMES;j++)
+      free(handoff[i][j]);
+
+  /* Blocks freed late in thread exit go back to the heap too, so it
+   * does not grow with every thread (mallinfo2 is zero with STATS=0). */
+  pthread_key_create(&lateKey, lateFree);
+  arena = mallinfo2().arena;
+  for(i=0;i<LATE;i++){
+    pthread_create(&tid[0], NULL, lateWorker, NULL);
+    pthread_join(tid[0], NULL);
+  }
+  if(mallinfo2().arena > arena + 1024*1024){
+    fprintf(stderr,"heap grew from %zu to %zu bytes freeing at thread exit\n",arena,mallinfo2().arena);
+    failed = 1;
+  }
+  return failed;
+}